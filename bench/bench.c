@@ -0,0 +1,360 @@
+#define _POSIX_C_SOURCE 200809L
+#include <time.h>
+#include <unistd.h>
+#include "../include/common.h"
+#include "../include/atedot.h"
+#include "../include/expr.h"
+
+// microbenchmarks for the hot paths, results as JSON on stdout
+// usage: atedot_bench [min_seconds_per_case]
+
+#define BENCH_ROUNDS 5          // timed rounds per case, median is reported
+#define BENCH_SEED 0x5eedu      // fixed seed so generated inputs are identical between runs
+
+typedef void (*BenchFn)(void *arg);
+
+static double min_seconds = 0.2;
+static bool first_result = true;
+static double last_allocs_per_op; // heap allocations per op during the timed rounds
+static volatile double sink; // keeps results alive
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// calibrate reps so a round takes ~min_seconds/BENCH_ROUNDS, return median seconds per op
+static double bench_run(BenchFn fn, void *arg, long *out_reps) {
+    long reps = 1;
+    double target = min_seconds / BENCH_ROUNDS;
+    for (;;) {
+        double t0 = now_sec();
+        for (long i = 0; i < reps; i++) fn(arg);
+        double dt = now_sec() - t0;
+        if (dt >= target || reps >= (1L << 30)) break;
+        reps = dt > 0 ? (long)(reps * (target / dt) * 1.1) + 1 : reps * 10;
+    }
+
+    double rounds[BENCH_ROUNDS];
+    uint64_t allocs0 = atedot_alloc_count;
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+        double t0 = now_sec();
+        for (long i = 0; i < reps; i++) fn(arg);
+        rounds[r] = (now_sec() - t0) / (double)reps;
+    }
+    qsort(rounds, BENCH_ROUNDS, sizeof(double), cmp_double);
+
+    *out_reps = reps * BENCH_ROUNDS;
+    last_allocs_per_op = (double)(atedot_alloc_count - allocs0) / (double)*out_reps;
+    return rounds[BENCH_ROUNDS / 2];
+}
+
+// one JSON object per case, extra holds preformatted ", \"key\": value" pairs
+static void report(const char *name, const char *params, double sec_per_op, long reps, const char *extra) {
+    printf("%s\n    {\"name\": \"%s\", \"params\": {%s}, \"iterations\": %ld, "
+           "\"ns_per_op\": %.1f, \"ops_per_sec\": %.1f, \"allocs_per_op\": %.3f%s}",
+           first_result ? "" : ",", name, params, reps,
+           sec_per_op * 1e9, sec_per_op > 0 ? 1.0 / sec_per_op : 0.0, last_allocs_per_op, extra ? extra : "");
+    first_result = false;
+}
+
+// expr_eval
+typedef struct {
+    const char *expr;
+    int n;          // evaluations per op
+} ExprArgs;
+
+static void bench_expr_eval(void *p) {
+    ExprArgs *a = p;
+    int err;
+    double acc = 0;
+    for (int i = 0; i < a->n; i++) acc += expr_eval(a->expr, -10.0 + 20.0 * i / a->n, &err);
+    sink = acc;
+}
+
+// expr_run, compiled once outside the timed loop
+typedef struct {
+    const ExprProgram *prog;
+    int n;
+} ExprRunArgs;
+
+static void bench_expr_run(void *p) {
+    ExprRunArgs *a = p;
+    int err;
+    double acc = 0;
+    for (int i = 0; i < a->n; i++) acc += expr_run(a->prog, -10.0 + 20.0 * i / a->n, NULL, &err);
+    sink = acc;
+}
+
+// plot_expr
+typedef struct {
+    Canvas *surf;
+    const char *expr;
+} PlotExprArgs;
+
+static void bench_plot_expr(void *p) {
+    PlotExprArgs *a = p;
+    canvas_clear(a->surf);
+    plot_expr(a->surf, a->expr, 0x00FF00, -10, 10, -5, 5);
+}
+
+// plot_parametric, x(t) and y(t) compiled once
+typedef struct {
+    Canvas *surf;
+    const ExprProgram *fx, *fy;
+} CurveArgs;
+
+static void bench_plot_curve(void *p) {
+    CurveArgs *a = p;
+    canvas_clear(a->surf);
+    plot_parametric(a->surf, a->fx, NULL, a->fy, NULL, 0, 6.2832, 0x4488FF, -5, 5, -5, 5);
+}
+
+// plot_from_csv
+typedef struct {
+    Canvas *surf;
+    const char *path;
+} CsvArgs;
+
+static void bench_plot_csv(void *p) {
+    CsvArgs *a = p;
+    double d1, d2, d3, d4;
+    canvas_clear(a->surf);
+    plot_from_csv(a->surf, a->path, 0, 1, 0x00FFFF, &d1, &d2, &d3, &d4);
+}
+
+// series_load_csv on its own, parse throughput
+typedef struct {
+    const char *path;
+    Series *series;
+} LoadArgs;
+
+static void bench_load(void *p) {
+    LoadArgs *a = p;
+    series_load_csv(a->series, a->path, 0, 1, 0);
+}
+
+// plot_series, redraw of csv samples already in memory
+typedef struct {
+    Canvas *surf;
+    const Series *series;
+} SeriesArgs;
+
+static void bench_plot_series(void *p) {
+    SeriesArgs *a = p;
+    const Series *s = a->series;
+    canvas_clear(a->surf);
+    plot_series(a->surf, s, 0x00FFFF, s->xmin, s->xmax, s->ymin, s->ymax);
+}
+
+// canvas_resize back and forth within capacity
+static void bench_resize(void *p) {
+    Canvas *surf = p;
+    canvas_resize(surf, 160, 80);
+    canvas_resize(surf, 320, 160);
+}
+
+// plot_line
+typedef struct {
+    Canvas *surf;
+} LineArgs;
+
+static void bench_plot_line(void *p) {
+    LineArgs *a = p;
+    int w = a->surf->px_w, h = a->surf->px_h;
+    plot_line(a->surf, 0, 0, w - 1, h - 1, 0xFF0000);
+    plot_line(a->surf, 0, h - 1, w - 1, 0, 0x00FF00);
+}
+
+// render_full_w_axes
+typedef struct {
+    Canvas *surf;
+    FILE *out;
+} RenderArgs;
+
+static void bench_render(void *p) {
+    RenderArgs *a = p;
+    render_full_w_axes_to(a->out, a->surf, -10, 10, -5, 5, 5, 5, true);
+}
+
+// ISO-8601 timestamped csv, one row per 250ms from 2026-01-01
+static long write_ts_csv(const char *path, long bytes) {
+    FILE *f = fopen(path, "w");
+    if (!f) { perror(path); exit(1); }
+
+    fputs("ts,y\n", f);
+    for (long i = 0; ftell(f) < bytes; i++) {
+        long ms = i * 250;
+        long sec = ms / 1000;
+        fprintf(f, "2026-01-%02ldT%02ld:%02ld:%02ld.%03ldZ,%ld\n",
+                1 + sec / 86400 % 28, sec / 3600 % 24, sec / 60 % 60, sec % 60, ms % 1000, i % 97);
+    }
+    long size = ftell(f);
+    fclose(f);
+    return size;
+}
+
+// deterministic csv of roughly `bytes` size, returns actual size
+static long write_csv(const char *path, long bytes) {
+    FILE *f = fopen(path, "w");
+    if (!f) { perror(path); exit(1); }
+
+    uint32_t state = BENCH_SEED;
+    fputs("x,y\n", f);
+    for (long i = 0; ftell(f) < bytes; i++) {
+        state = state * 1664525u + 1013904223u; // LCG
+        double y = sin(i * 0.001) + (double)(state >> 8) / (double)(1u << 24) * 0.1;
+        fprintf(f, "%ld,%.6f\n", i, y);
+    }
+    long size = ftell(f);
+    fclose(f);
+    return size;
+}
+
+int main(int argc, char **argv) {
+    setlocale(LC_ALL, "");
+    if (argc > 1) min_seconds = atof(argv[1]);
+    if (min_seconds <= 0) min_seconds = 0.2;
+
+    char extra[256];
+    char params[256];
+    long reps;
+    double t;
+
+    printf("{\n  \"suite\": \"atedot_bench\",\n  \"min_seconds\": %.3f,\n  \"results\": [", min_seconds);
+
+    // expr_eval throughput
+    const char *exprs[] = { "x", "sin(x)*exp(-x^2/10)", "sqrt(abs(x))+log(x^2+1)*cos(3*x)-tan(x/7)" };
+    for (size_t i = 0; i < sizeof(exprs) / sizeof(exprs[0]); i++) {
+        ExprArgs a = { exprs[i], 1000 };
+        t = bench_run(bench_expr_eval, &a, &reps);
+        snprintf(params, sizeof(params), "\"expr\": \"%s\"", exprs[i]);
+        snprintf(extra, sizeof(extra), ", \"evals_per_sec\": %.1f", a.n / t);
+        report("expr_eval", params, t / a.n, reps * a.n, extra);
+    }
+    for (size_t i = 0; i < sizeof(exprs) / sizeof(exprs[0]); i++) {
+        ExprProgram prog;
+        expr_compile(&prog, exprs[i]);
+        ExprRunArgs a = { &prog, 1000 };
+        t = bench_run(bench_expr_run, &a, &reps);
+        snprintf(params, sizeof(params), "\"expr\": \"%s\"", exprs[i]);
+        snprintf(extra, sizeof(extra), ", \"evals_per_sec\": %.1f", a.n / t);
+        report("expr_run", params, t / a.n, reps * a.n, extra);
+    }
+
+    // plot_expr per frame at several canvas sizes
+    const int sizes[][2] = { {100, 64}, {320, 160}, {1000, 400} };
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        Canvas surf = canvas_make(sizes[i][0], sizes[i][1]);
+        PlotExprArgs a = { &surf, "sin(x)*exp(-x^2/10)" };
+        t = bench_run(bench_plot_expr, &a, &reps);
+        snprintf(params, sizeof(params), "\"w\": %d, \"h\": %d, \"expr\": \"%s\"", sizes[i][0], sizes[i][1], a.expr);
+        report("plot_expr", params, t, reps, NULL);
+        canvas_free(&surf);
+    }
+
+    // lissajous curve per frame
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        Canvas surf = canvas_make(sizes[i][0], sizes[i][1]);
+        ExprProgram fx, fy;
+        expr_compile_var(&fx, "4*cos(3*t)", "t");
+        expr_compile_var(&fy, "4*sin(2*t)", "t");
+        CurveArgs a = { &surf, &fx, &fy };
+        t = bench_run(bench_plot_curve, &a, &reps);
+        snprintf(params, sizeof(params), "\"w\": %d, \"h\": %d, \"x\": \"4*cos(3*t)\", \"y\": \"4*sin(2*t)\"", sizes[i][0], sizes[i][1]);
+        report("plot_parametric", params, t, reps, NULL);
+        canvas_free(&surf);
+    }
+
+    // plot_from_csv MB/s on generated files
+    const long csv_sizes[] = { 1L << 16, 1L << 20, 8L << 20 };
+    for (size_t i = 0; i < sizeof(csv_sizes) / sizeof(csv_sizes[0]); i++) {
+        char path[64];
+        snprintf(path, sizeof(path), "/tmp/atedot_bench_%d_%zu.csv", (int)getpid(), i);
+        long size = write_csv(path, csv_sizes[i]);
+
+        Canvas surf = canvas_make(320, 160);
+        CsvArgs a = { &surf, path };
+        t = bench_run(bench_plot_csv, &a, &reps);
+        snprintf(params, sizeof(params), "\"bytes\": %ld", size);
+        snprintf(extra, sizeof(extra), ", \"mb_per_sec\": %.2f", size / t / 1e6);
+        report("plot_from_csv", params, t, reps, extra);
+
+        Series series = {0};
+        series_load_csv(&series, path, 0, 1, 0);
+        SeriesArgs sa = { &surf, &series };
+        t = bench_run(bench_plot_series, &sa, &reps);
+        snprintf(params, sizeof(params), "\"points\": %zu", series.len);
+        report("plot_series", params, t, reps, NULL);
+        series_free(&series);
+
+        canvas_free(&surf);
+        remove(path);
+    }
+
+    // timestamp parsing
+    {
+        char path[64];
+        snprintf(path, sizeof(path), "/tmp/atedot_bench_%d_ts.csv", (int)getpid());
+        long size = write_ts_csv(path, 8L << 20);
+
+        Series series = {0};
+        LoadArgs a = { path, &series };
+        t = bench_run(bench_load, &a, &reps);
+        snprintf(params, sizeof(params), "\"bytes\": %ld, \"x\": \"iso8601\"", size);
+        snprintf(extra, sizeof(extra), ", \"mb_per_sec\": %.2f, \"rows\": %zu", size / t / 1e6, series.len);
+        report("series_load_csv", params, t, reps, extra);
+
+        series_free(&series);
+        remove(path);
+    }
+
+    // canvas_resize within capacity
+    {
+        Canvas surf = canvas_make(320, 160);
+        t = bench_run(bench_resize, &surf, &reps);
+        report("canvas_resize", "\"w\": 320, \"h\": 160", t, reps, NULL);
+        canvas_free(&surf);
+    }
+
+    // plot_line long-line rasterization
+    const int line_sizes[][2] = { {1000, 1000}, {8000, 2000} };
+    for (size_t i = 0; i < sizeof(line_sizes) / sizeof(line_sizes[0]); i++) {
+        Canvas surf = canvas_make(line_sizes[i][0], line_sizes[i][1]);
+        LineArgs a = { &surf };
+        t = bench_run(bench_plot_line, &a, &reps);
+        long pixels = 2L * (line_sizes[i][0] > line_sizes[i][1] ? line_sizes[i][0] : line_sizes[i][1]);
+        snprintf(params, sizeof(params), "\"w\": %d, \"h\": %d", line_sizes[i][0], line_sizes[i][1]);
+        snprintf(extra, sizeof(extra), ", \"pixels_per_sec\": %.1f", pixels / t);
+        report("plot_line", params, t, reps, extra);
+        canvas_free(&surf);
+    }
+
+    // render_full_w_axes to /dev/null
+    FILE *devnull = fopen("/dev/null", "w");
+    if (!devnull) { perror("/dev/null"); return 1; }
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        Canvas surf = canvas_make(sizes[i][0], sizes[i][1]);
+        plot_expr(&surf, "sin(x)*exp(-x^2/10)", 0x00FF00, -10, 10, -5, 5);
+        plot_line(&surf, 0, surf.px_h / 2, surf.px_w - 1, surf.px_h / 2, 0x000000);
+
+        size_t frame_bytes = render_full_w_axes_to(devnull, &surf, -10, 10, -5, 5, 5, 5, true);
+
+        RenderArgs a = { &surf, devnull };
+        t = bench_run(bench_render, &a, &reps);
+        snprintf(params, sizeof(params), "\"w\": %d, \"h\": %d", sizes[i][0], sizes[i][1]);
+        snprintf(extra, sizeof(extra), ", \"bytes_per_frame\": %zu, \"mb_per_sec\": %.2f", frame_bytes, frame_bytes / t / 1e6);
+        report("render_full_w_axes", params, t, reps, extra);
+        canvas_free(&surf);
+    }
+    fclose(devnull);
+
+    printf("\n  ]\n}\n");
+    return 0;
+}
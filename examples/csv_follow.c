@@ -0,0 +1,111 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include "../include/common.h"
+#include "../include/atedot.h"
+#include "../include/plots.h"
+
+// follows a csv through appends, a split last line, rotation and truncation
+// the way watch mode does, and after every step checks the samples, extent,
+// fit overlay and raster against the file loaded from scratch
+
+#define W 120
+#define H 48
+
+static const char *path = "csv_follow.csv";
+static const char *rotated = "csv_follow.csv.new";
+
+static void write_file(const char *p, const char *mode, const char *text) {
+    FILE *f = fopen(p, mode);
+    if (!f) { perror(p); exit(1); }
+    fputs(text, f);
+    fclose(f);
+}
+
+// samples of y = a*x + b plus a wobble, so the fit is not exact
+static void write_line(const char *p, const char *mode, int from, int to, double a, double b) {
+    FILE *f = fopen(p, mode);
+    if (!f) { perror(p); exit(1); }
+    for (int i = from; i < to; i++) fprintf(f, "%d,%.3f\n", i, a * i + b + (i % 3 - 1) * 0.5);
+    fclose(f);
+}
+
+static PlotRegistry follow_reg;
+static PlotRegistry fresh_reg;
+static ParamTable params;
+static Canvas follow_surf, fresh_surf;
+
+// a fit overlay over the csv, drawn once so it accumulates its sums
+static void open_plots(PlotRegistry *plots, Canvas *surf) {
+    Overlay fit = { .kind = OVERLAY_FIT_LINEAR };
+    if (!plots_add_csv(plots, path, 0, 1, 0, 0x00FFFF) || !plots_add_overlay(plots, fit, 0xFF00FF)) {
+        fprintf(stderr, "Error: Can't load %s\n", path);
+        exit(1);
+    }
+    const Series *s = &plots->items[0].series;
+    plots_draw(plots, &params, surf, s->xmin, s->xmax, s->ymin, s->ymax);
+}
+
+// the followed plot against a fresh load of the same file, 1 on a mismatch
+static int check(const char *step) {
+    plots_update_csv(&follow_reg, 0);
+    plots_clear(&fresh_reg);
+    open_plots(&fresh_reg, &fresh_surf);
+
+    const Series *a = &follow_reg.items[0].series, *b = &fresh_reg.items[0].series;
+    plots_draw(&follow_reg, &params, &follow_surf, b->xmin, b->xmax, b->ymin, b->ymax);
+    const Overlay *fa = &follow_reg.items[1].overlay, *fb = &fresh_reg.items[1].overlay;
+
+    const char *bad = NULL;
+    if (a->len != b->len || memcmp(a->x, b->x, a->len * sizeof(double)) || memcmp(a->y, b->y, a->len * sizeof(double)))
+        bad = "samples";
+    else if (a->xmin != b->xmin || a->xmax != b->xmax || a->ymin != b->ymin || a->ymax != b->ymax) bad = "extent";
+    else if (fa->fitted != fb->fitted || fabs(fa->slope - fb->slope) > 1e-9 * (1 + fabs(fb->slope))
+             || fabs(fa->intercept - fb->intercept) > 1e-9 * (1 + fabs(fb->intercept))) bad = "fit";
+    else if (memcmp(follow_surf.cells, fresh_surf.cells, (size_t)follow_surf.cell_w * (size_t)follow_surf.cell_h))
+        bad = "raster";
+
+    printf("%-28s %6zu rows  slope %8.4f  %s\n", step, a->len, fa->slope, bad ? bad : "ok");
+    if (bad) printf("  got y [%g, %g] fit %g + %g*x, want y [%g, %g] fit %g + %g*x\n",
+                    a->ymin, a->ymax, fa->intercept, fa->slope, b->ymin, b->ymax, fb->intercept, fb->slope);
+    return bad ? 1 : 0;
+}
+
+int main(void) {
+    follow_surf = canvas_make(W, H);
+    fresh_surf = canvas_make(W, H);
+    int failed = 0;
+
+    write_line(path, "w", 0, 200, 2.0, 1.0);
+    open_plots(&follow_reg, &follow_surf);
+    failed += check("initial load");
+
+    write_line(path, "a", 200, 300, 2.0, 1.0);
+    failed += check("append");
+
+    write_file(path, "a", "300,5");
+    failed += check("unterminated last line");
+    write_file(path, "a", "00\n301,603.5\n");
+    failed += check("last line completed");
+
+    // rotation: a new file renamed over the old one, then appended to
+    write_line(rotated, "w", 0, 50, -3.0, 40.0);
+    if (rename(rotated, path) != 0) { perror(rotated); return 1; }
+    failed += check("rotated");
+    write_line(path, "a", 50, 120, -3.0, 40.0);
+    failed += check("append after rotation");
+
+    // truncation in place, then appended to
+    write_line(path, "w", 0, 20, 0.5, -7.0);
+    failed += check("truncated");
+    write_line(path, "a", 20, 80, 0.5, -7.0);
+    failed += check("append after truncation");
+
+    plots_free(&follow_reg);
+    plots_free(&fresh_reg);
+    canvas_free(&follow_surf);
+    canvas_free(&fresh_surf);
+    remove(path);
+
+    printf("%s\n", failed ? "FAILED" : "all steps match a fresh load");
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,116 @@
+#define _POSIX_C_SOURCE 200809L
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include "../include/common.h"
+#include "../include/atedot.h"
+
+// renders the same set of charts from 1, 2, 4, ... threads, one context each,
+// and checks every frame against a single-threaded reference
+
+#define CHARTS 64           // distinct charts, chart i uses a = 1 + i / 8
+#define FRAME_CAP (1 << 18)
+
+static char csv_path[64];
+static uint64_t reference[CHARTS];
+
+typedef struct {
+    int charts;             // charts to render
+    int offset;             // first chart index
+    long mismatches;
+} Worker;
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// FNV-1a
+static uint64_t hash(const char *s, size_t n) {
+    uint64_t h = 1469598103934665603ull;
+    for (size_t i = 0; i < n; i++) h = (h ^ (uint8_t)s[i]) * 1099511628211ull;
+    return h;
+}
+
+static uint64_t render_chart(AtedotContext *ctx, char *frame, int i) {
+    ctx_clear(ctx);
+    ctx_set_param(ctx, "a", 1.0 + i / 8.0);
+    ctx_plot_csv(ctx, csv_path, 0, 1, 0x00FFFF);
+    ctx_set_view(ctx, -10, 10, -2, 2);
+    ctx_plot_expr(ctx, "sin(a*x)*exp(-x^2/20)", 0x00FF00);
+    ctx_plot_expr(ctx, "cos(x/a)", 0xFF00FF);
+    size_t len = ctx_render_to_buffer(ctx, frame, FRAME_CAP);
+    return hash(frame, len < FRAME_CAP ? len : FRAME_CAP - 1);
+}
+
+static void *worker(void *arg) {
+    Worker *w = arg;
+    AtedotContext *ctx = ctx_make(160, 64);
+    char *frame = MALLOC(char, FRAME_CAP);
+
+    for (int k = 0; k < w->charts; k++) {
+        int i = (w->offset + k) % CHARTS;
+        if (render_chart(ctx, frame, i) != reference[i]) w->mismatches++;
+    }
+
+    free(frame);
+    ctx_free(ctx);
+    return NULL;
+}
+
+int main(int argc, char **argv) {
+    int per_thread = argc > 1 ? atoi(argv[1]) : 2000;
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int max_threads = argc > 2 ? atoi(argv[2]) : (int)(cores > 1 ? cores : 1) * 2;
+
+    // a noisy sine in a temp csv, loaded by every chart
+    strcpy(csv_path, "/tmp/atedot_stress_XXXXXX");
+    int fd = mkstemp(csv_path);
+    FILE *f = fd >= 0 ? fdopen(fd, "w") : NULL;
+    if (!f) {
+        perror("mkstemp");
+        return 1;
+    }
+    for (int i = 0; i < 2000; i++) {
+        double x = -10 + 20.0 * i / 2000;
+        fprintf(f, "%.4f,%.4f\n", x, sin(x) * 0.8 + 0.1 * sin(x * 37.0));
+    }
+    fclose(f);
+
+    AtedotContext *ctx = ctx_make(160, 64);
+    char *frame = MALLOC(char, FRAME_CAP);
+    for (int i = 0; i < CHARTS; i++) reference[i] = render_chart(ctx, frame, i);
+    free(frame);
+    ctx_free(ctx);
+
+    printf("%ld cores, %d charts per thread\n", cores, per_thread);
+    printf("threads  charts/s   speedup  mismatches\n");
+
+    double base = 0;
+    int status = 0;
+    for (int n = 1; n <= max_threads; n *= 2) {
+        pthread_t threads[256];
+        Worker workers[256];
+        if (n > 256) break;
+
+        double t0 = now();
+        for (int t = 0; t < n; t++) {
+            workers[t] = (Worker){ per_thread, t * 7, 0 };
+            pthread_create(&threads[t], NULL, worker, &workers[t]);
+        }
+        long mismatches = 0;
+        for (int t = 0; t < n; t++) {
+            pthread_join(threads[t], NULL);
+            mismatches += workers[t].mismatches;
+        }
+        double rate = (double)n * per_thread / (now() - t0);
+        if (n == 1) base = rate;
+
+        printf("%7d  %9.0f  %7.2fx  %10ld\n", n, rate, rate / base, mismatches);
+        if (mismatches) status = 1;
+    }
+
+    remove(csv_path);
+    return status;
+}
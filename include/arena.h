@@ -0,0 +1,21 @@
+#pragma once
+#include <stddef.h>
+#include "common.h"
+
+// chunked bump allocator, everything is released at once
+// reset keeps the blocks around so refilling it does not touch the heap
+typedef struct ArenaBlock {
+    struct ArenaBlock *next;
+    size_t used, cap;
+    max_align_t data[];
+} ArenaBlock;
+
+typedef struct {
+    ArenaBlock *first;
+    ArenaBlock *cur;
+} Arena;
+
+void *arena_alloc(Arena *a, size_t size);       // aligned for any type
+char *arena_strdup(Arena *a, const char *s);
+void arena_reset(Arena *a);
+void arena_free(Arena *a);
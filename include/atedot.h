@@ -1,15 +1,65 @@
 #pragma once
 #include "common.h"
+#include "expr.h"
 
 typedef struct {
     int px_w, px_h;         // pixel-space size
     int cell_w, cell_h;     // braille character grid
     uint8_t *cells;         // bits map to braille dots
     uint32_t *colors;       // color per pixel
+    size_t cells_cap;       // allocated sizes, kept across resizes
+    size_t colors_cap;
 } Canvas;
 
+// x/y samples loaded once from a csv and redrawn from memory
+typedef struct {
+    double *x, *y;
+    size_t len, cap;
+    double xmin, xmax, ymin, ymax;
+    bool x_time;            // x holds epoch seconds (ISO-8601 or epoch-ms column)
+} Series;
+
+#define SERIES_X_EPOCH_MS 1 // x column is epoch milliseconds
+
+// read position in a csv that keeps growing, zeroed before the first read
+typedef struct {
+    uint64_t offset;        // bytes parsed, always at a line boundary
+    uint64_t dev, ino;      // file that was read, a different one means rotation
+    size_t tail_rows;       // rows from an unterminated last line, parsed again next time
+    double xmin, xmax, ymin, ymax; // series extent without those rows
+} CsvCursor;
+
+typedef enum {
+    CSV_ERROR = -1,
+    CSV_UNCHANGED,
+    CSV_APPENDED,           // rows past the old end were added
+    CSV_RELOADED            // read from the start (first read, truncation, rotation)
+} CsvUpdate;
+
+typedef enum {
+    OVERLAY_MEAN,           // trailing rolling mean over `window` samples
+    OVERLAY_FIT_LINEAR,     // least squares line
+    OVERLAY_BAND            // q_lo..q_hi percentile envelope per pixel column
+} OverlayKind;
+
+typedef struct {
+    OverlayKind kind;
+    int window;
+    double q_lo, q_hi;      // percentiles, 0-100
+
+    // running regression sums, extended when the series grows
+    size_t fitted;
+    double x_ref;
+    double sum_x, sum_y, sum_xx, sum_xy;
+    double slope, intercept;
+
+    // per-column row histograms for bands, capacity kept between frames
+    uint32_t *bins;
+    size_t bin_cap;
+} Overlay;
+
 Canvas canvas_make(int px_w, int px_h); // (col, row)
-void canvas_resize(Canvas *surf, int new_w, int new_h);
+void canvas_resize(Canvas *surf, int new_w, int new_h); // only reallocates when growing
 void canvas_free(Canvas *surf);
 void canvas_clear(Canvas *surf);
 
@@ -22,10 +72,88 @@ void render_full_w_axes(const Canvas *surf,
                 double xmin, double xmax, double ymin, double ymax,
                 int x_ticks, int y_ticks, bool use_color);
 
+// same as above but to any stream (file, pipe, ...), return bytes written
+size_t render_row_to(FILE *out, const Canvas *surf, int y, bool use_color);
+size_t render_full_to(FILE *out, const Canvas *surf, bool use_color);
+size_t render_full_w_axes_to(FILE *out, const Canvas *surf,
+                double xmin, double xmax, double ymin, double ymax,
+                int x_ticks, int y_ticks, bool use_color);
+// x is epoch seconds, ticks snap to minutes/hours/days/...
+size_t render_full_w_time_axis_to(FILE *out, const Canvas *surf,
+                double xmin, double xmax, double ymin, double ymax,
+                int x_ticks, int y_ticks, bool use_color);
+
+// one viewport of a composed frame
+typedef struct {
+    const Canvas *surf;
+    double xmin, xmax, ymin, ymax;
+    bool time_axis;         // x is epoch seconds
+} RenderPane;
+
+// rows x cols panes in row-major order, each with its own y labels and x axis,
+// composed line by line into one frame; a 1x1 grid is render_full_w_axes_to
+size_t render_grid_to(FILE *out, const RenderPane *panes, int rows, int cols,
+                int x_ticks, int y_ticks, bool use_color);
+
 int plot_line(Canvas *surf, int x0, int y0, int x1, int y1, uint32_t color); // bresenham line
 
 int plot_expr(Canvas *surf, const char *func, uint32_t color,
               double xmin, double xmax, double ymin, double ymax);
+// y = f(x) from a compiled expression, params bound as in expr_run
+int plot_program(Canvas *surf, const ExprProgram *prog, const double *params, uint32_t color,
+              double xmin, double xmax, double ymin, double ymax);
+
+// curves over t in [t0, t1], programs compiled with t as the free variable
+// sampling follows the on-screen arc length and samples are joined with lines
+int plot_parametric(Canvas *surf, const ExprProgram *fx, const double *fx_params,
+              const ExprProgram *fy, const double *fy_params, double t0, double t1,
+              uint32_t color, double xmin, double xmax, double ymin, double ymax);
+int plot_polar(Canvas *surf, const ExprProgram *r, const double *params, double t0, double t1,
+              uint32_t color, double xmin, double xmax, double ymin, double ymax);
 
 int plot_from_csv(Canvas *surf, const char *path, int xcol, int ycol, uint32_t color,
                 double *out_xmin, double *out_xmax, double *out_ymin, double *out_ymax);
+
+int series_load_csv(Series *s, const char *path, int xcol, int ycol, int flags); // 0 on success
+// parse complete lines of buf into s, returns bytes consumed
+// the trailing partial line is left unless `final`
+size_t series_parse_csv(Series *s, const char *buf, size_t len, bool final,
+                int xcol, int ycol, int flags);
+// parse what was appended since the cursor, or the whole file again after
+// truncation or rotation, returns a CsvUpdate
+int series_update_csv(Series *s, CsvCursor *cur, const char *path, int xcol, int ycol, int flags);
+void series_reset(Series *s);
+void series_free(Series *s);
+int plot_series(Canvas *surf, const Series *s, uint32_t color,
+                double xmin, double xmax, double ymin, double ymax);
+// samples [from, len) without the axes, for rows appended since the last draw
+int plot_series_from(Canvas *surf, const Series *s, size_t from, uint32_t color,
+                double xmin, double xmax, double ymin, double ymax);
+
+int plot_overlay(Canvas *surf, const Series *s, Overlay *o, uint32_t color,
+                double xmin, double xmax, double ymin, double ymax);
+void overlay_reset(Overlay *o);  // drop the running fit, the next draw starts from sample 0
+void overlay_free(Overlay *o);
+
+// self-contained plotting state for embedding: canvas, view, plots, parameters,
+// loaded samples and the frame buffer all belong to the context
+// contexts share nothing, so each may be used from its own thread without locks
+typedef struct AtedotContext AtedotContext;
+
+AtedotContext *ctx_make(int px_w, int px_h);
+void ctx_free(AtedotContext *ctx);
+void ctx_clear(AtedotContext *ctx);                     // drop plots, keep buffers and settings
+void ctx_resize(AtedotContext *ctx, int px_w, int px_h);
+// fixed view, otherwise each csv plot fits the view to its samples and the last one wins
+void ctx_set_view(AtedotContext *ctx, double xmin, double xmax, double ymin, double ymax);
+void ctx_set_ticks(AtedotContext *ctx, int x_ticks, int y_ticks);
+void ctx_set_color(AtedotContext *ctx, bool use_color);
+void ctx_set_time_axis(AtedotContext *ctx, bool time_axis);
+int ctx_set_param(AtedotContext *ctx, const char *name, double value); // -1 if the table is full
+
+int ctx_plot_expr(AtedotContext *ctx, const char *expr, uint32_t color); // -1 on a syntax error or a full parameter table
+int ctx_plot_csv(AtedotContext *ctx, const char *path, int xcol, int ycol, uint32_t color); // -1 if nothing loads
+
+// frame with axes into buf, NUL-terminated and cut to cap like snprintf,
+// returns the full length; plots are only redrawn after a change
+size_t ctx_render_to_buffer(AtedotContext *ctx, char *buf, size_t cap);
@@ -0,0 +1,12 @@
+#pragma once
+#include "common.h"
+
+// render independent scripts in parallel, each in its own forked worker
+// with at most `jobs` running at once, frames go to out_dir (stdout if NULL)
+// frames are <out_dir>/<stem>-NNNN.txt, scripts sharing a basename are told
+// apart by their position ("3-chart"), returns number of scripts that failed
+int batch_run(char **scripts, int n_scripts, const char *out_dir, int jobs, bool use_color);
+
+// script paths from a manifest file, one per line, '#' comments allowed
+char **batch_read_manifest(const char *path, int *out_count);
+void batch_free_manifest(char **scripts, int n_scripts);
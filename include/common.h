@@ -9,7 +9,12 @@
 #include <math.h>
 #include <locale.h>
 
+// heap allocations made through the helpers below, see stats/bench output
+// counted per thread so parallel rasterisation needs no atomics
+extern _Thread_local uint64_t atedot_alloc_count;
+
 static inline void* xcalloc(size_t count, size_t size) {
+    atedot_alloc_count++;
     void *p = calloc(count, size);
     if (!p && count > 0 && size > 0) {
         fprintf(stderr, "Fatal: Out of memory\n");
@@ -19,6 +24,7 @@ static inline void* xcalloc(size_t count, size_t size) {
 }
 
 static inline void* xmalloc(size_t size) {
+    atedot_alloc_count++;
     void *p = malloc(size);
     if (!p && size > 0) {
         fprintf(stderr, "Fatal: Out of memory\n");
@@ -27,6 +33,12 @@ static inline void* xmalloc(size_t size) {
     return p;
 }
 
+// NULL on failure, old block stays valid
+static inline void* xrealloc(void *p, size_t size) {
+    atedot_alloc_count++;
+    return realloc(p, size);
+}
+
 #define CALLOC(T, n)   ((T*)xcalloc((size_t)(n), sizeof(T)))
 #define MALLOC(T, n)   ((T*)xmalloc((size_t)(n) * sizeof(T)))
-#define REALLOC(T, p, n) ((T*)realloc((p), (size_t)(n) * sizeof(T)))
+#define REALLOC(T, p, n) ((T*)xrealloc((p), (size_t)(n) * sizeof(T)))
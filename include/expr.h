@@ -1,3 +1,33 @@
 #pragma once
+#include "common.h"
 
+#define EXPR_MAX_CODE   128     // instructions per program
+#define EXPR_MAX_STACK  32
+#define EXPR_MAX_PARAMS 8       // named parameters per program
+#define EXPR_MAX_NAME   16
+#define EXPR_BATCH      64      // samples per block in expr_run_batch
+
+typedef struct {
+    uint8_t op, arg;
+    double value;
+} ExprInstr;
+
+// compiled expression, a flat postfix program over x and named parameters
+// fixed size, so it can live on the stack or in an arena
+typedef struct {
+    ExprInstr code[EXPR_MAX_CODE];
+    int len;
+    char params[EXPR_MAX_PARAMS][EXPR_MAX_NAME]; // names in order of first use
+    int n_params;
+} ExprProgram;
+
+int expr_compile(ExprProgram *prog, const char *expression); // 0 on success
+int expr_compile_var(ExprProgram *prog, const char *expression, const char *var); // free variable other than x
+int expr_param_index(const ExprProgram *prog, const char *name); // -1 if unused
+// params[i] is the value of prog->params[i], may be NULL without parameters
+double expr_run(const ExprProgram *prog, double x, const double *params, int *error);
+// out[i] = f(x[i]) for n samples, failures are NaN instead of an error flag
+void expr_run_batch(const ExprProgram *prog, const double *x, double *out, int n, const double *params);
+
+// compile and run once, expressions with parameters are an error
 double expr_eval(const char *expression, double x, int *error);
@@ -0,0 +1,54 @@
+#pragma once
+#include "common.h"
+#include "atedot.h"
+
+// world -> pixel mapping of a view onto a canvas, y grows downwards
+// a degenerate range maps as if it were 1 wide instead of dividing by ~0
+typedef struct {
+    double xmin, ymax;
+    double xrange, yrange;  // view size
+    double sx, sy;          // pixels per world unit
+    int w, h;
+} Mapping;
+
+static inline Mapping mapping_make(const Canvas *surf, double xmin, double xmax, double ymin, double ymax) {
+    Mapping m = { xmin, ymax, xmax - xmin, ymax - ymin, 0, 0, surf->px_w, surf->px_h };
+    if (fabs(m.xrange) < 1e-9) m.xrange = 1.0;
+    if (fabs(m.yrange) < 1e-9) m.yrange = 1.0;
+    m.sx = (surf->px_w - 1) / m.xrange;
+    m.sy = (surf->px_h - 1) / m.yrange;
+    return m;
+}
+
+// false off the canvas, also for NaN
+static inline bool map_point(const Mapping *m, double x, double y, int *px, int *py) {
+    double fx = (x - m->xmin) * m->sx;
+    double fy = (m->ymax - y) * m->sy;
+    if (!(fx >= 0 && fy >= 0 && fx < m->w && fy < m->h)) return false;
+    *px = (int)fx;
+    *py = (int)fy;
+    return true;
+}
+
+// Liang-Barsky against the canvas, false if the segment misses it entirely
+static inline bool clip_segment(const Mapping *m, double *x0, double *y0, double *x1, double *y1) {
+    double dx = *x1 - *x0, dy = *y1 - *y0;
+    double p[4] = { -dx, dx, -dy, dy };
+    double q[4] = { *x0, m->w - 1 - *x0, *y0, m->h - 1 - *y0 };
+    double u0 = 0, u1 = 1;
+
+    for (int i = 0; i < 4; i++) {
+        if (p[i] == 0) {
+            if (q[i] < 0) return false;
+            continue;
+        }
+        double u = q[i] / p[i];
+        if (p[i] < 0) { if (u > u1) return false; if (u > u0) u0 = u; }
+        else { if (u < u0) return false; if (u < u1) u1 = u; }
+    }
+
+    double ax = *x0, ay = *y0;
+    *x0 = ax + u0 * dx; *y0 = ay + u0 * dy;
+    *x1 = ax + u1 * dx; *y1 = ay + u1 * dy;
+    return true;
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include "common.h"
+#include "atedot.h"
+#include "arena.h"
+
+#define PLOTS_MAX_PARAMS 32
+
+// named expression parameters
+typedef struct {
+    char name[EXPR_MAX_NAME];
+    double value;
+} Param;
+
+typedef struct {
+    Param items[PLOTS_MAX_PARAMS];
+    int count;
+} ParamTable;
+
+typedef enum {
+    PLOT_MODE_EXPR,
+    PLOT_MODE_CSV,
+    PLOT_MODE_OVERLAY,
+    PLOT_MODE_PARAM,        // x = prog(t), y = prog_y(t)
+    PLOT_MODE_POLAR         // r = prog(t)
+} PlotMode;
+
+typedef struct {
+    PlotMode mode;
+    const char *source;     // expression or csv path, lives in the registry arena
+    ExprProgram *prog;      // compiled expression, also in the arena
+    ExprProgram *prog_y;    // y(t) of a parametric curve
+    double t0, t1;          // curve parameter range
+    uint32_t color;
+    int col_x, col_y;
+    int flags;              // SERIES_X_* the csv was loaded with
+    Series series;          // csv samples, extended when the file grows
+    CsvCursor cursor;       // how far the csv has been read
+    Overlay overlay;        // overlay state, drawn over plot `target`
+    int target;
+} PlotCmd;
+
+// plots in drawing order, grows by doubling inside the arena
+// zero-initialised is empty
+typedef struct {
+    PlotCmd *items;
+    int count, cap;
+    Arena arena;
+} PlotRegistry;
+
+Param *params_find(ParamTable *t, const char *name);
+Param *params_set(ParamTable *t, const char *name, double value); // NULL if full or the name is too long
+// values for prog->params in slot order, read-only so threads can share the table
+void params_bind(const ParamTable *t, const ExprProgram *prog, double *values);
+
+// parameters seen for the first time start at 1, a plot that fails
+// (syntax error, parameter table full) leaves the table as it was
+PlotCmd *plots_add_expr(PlotRegistry *plots, ParamTable *params, const char *expr, uint32_t color);
+// parametric (fy given) or polar curve over t
+PlotCmd *plots_add_curve(PlotRegistry *plots, ParamTable *params, const char *fx, const char *fy,
+                         double t0, double t1, uint32_t color);
+// loads the samples up front, NULL if the file gives nothing to plot
+// the cursor remembers where the file ended, for watching it
+PlotCmd *plots_add_csv(PlotRegistry *plots, const char *path, int xcol, int ycol, int flags, uint32_t color);
+PlotCmd *plots_add_overlay(PlotRegistry *plots, Overlay ov, uint32_t color); // over the latest csv plot
+// read what was appended to csv plot k, returns a CsvUpdate
+// overlays over it fit again from the start when samples they saw were replaced
+int plots_update_csv(PlotRegistry *plots, int k);
+void plots_remove_overlays(PlotRegistry *plots);  // keeps everything else in order
+bool plots_use_param(const PlotRegistry *plots, const char *name);
+void plots_clear(PlotRegistry *plots);            // keeps the arena blocks
+void plots_free(PlotRegistry *plots);
+
+// wipes the canvas and draws every plot in order
+void plots_draw(PlotRegistry *plots, const ParamTable *params, Canvas *surf,
+                double xmin, double xmax, double ymin, double ymax);
@@ -1,4 +1,10 @@
 #pragma once
 #include "atedot.h"
 
-void repl(Canvas *surf);
\ No newline at end of file
+void repl(Canvas *surf);
+
+// run REPL commands from a file without touching the terminal
+// frames go to <out_dir>/<stem>-NNNN.txt, or stdout if out_dir is NULL
+// returns number of frames rendered, -1 if the script can't be opened or
+// any command failed (each failure is reported with its line)
+int repl_run_script(Canvas *surf, const char *path, const char *out_dir, const char *stem, bool use_color);
@@ -0,0 +1,57 @@
+#pragma once
+#include "common.h"
+
+// per-stage timers and counters for the hot paths
+// everything is behind one predictable branch on stats_enabled,
+// build with -DATEDOT_NO_STATS to compile it out completely
+
+typedef enum {
+    STAGE_REPLOT,       // replot_all
+    STAGE_PLOT_EXPR,    // plot_expr
+    STAGE_PLOT_CSV,     // plot_series, csv samples already in memory
+    STAGE_OVERLAY,      // plot_overlay
+    STAGE_CSV_LOAD,     // series_load_csv, file parsing
+    STAGE_RENDER,       // render_full_w_axes
+    STAGE_COUNT
+} StatsStage;
+
+typedef enum {
+    COUNTER_EVALS,      // expression evaluations
+    COUNTER_PIXELS,     // canvas pixels set
+    COUNTER_BYTES,      // bytes written by the renderer
+    COUNTER_ALLOCS,     // heap allocations, filled in by stats_frame_end
+    COUNTER_COUNT
+} StatsCounter;
+
+typedef struct {
+    double stage_sec[STAGE_COUNT];
+    long stage_calls[STAGE_COUNT];
+    uint64_t counters[COUNTER_COUNT];
+} FrameStats;
+
+// timers and counters are per thread, workers hand theirs to stats_merge
+extern bool stats_enabled;
+extern _Thread_local FrameStats stats_current;  // frame being built
+extern _Thread_local int stats_tid;             // trace lane, 1 on the main thread
+extern FrameStats stats_last;                   // last finished frame
+
+double stats_now(void);                         // monotonic seconds
+void stats_stage_end(StatsStage stage, double t0);
+void stats_merge(const FrameStats *fs);          // add a worker's stats to the current frame
+void stats_frame_end(void);                     // current -> last, reset current
+void stats_print(FILE *out, const FrameStats *fs);
+
+// chrome trace-event output (chrome://tracing, perfetto)
+bool stats_trace_start(const char *path);       // enables stats, drops old events
+const char *stats_trace_path(void);             // NULL if not tracing
+int stats_trace_finish(void);                   // write file, 0 on success
+
+#ifndef ATEDOT_NO_STATS
+#define STATS_BEGIN(t0) double t0 = stats_enabled ? stats_now() : 0.0
+#define STATS_END(stage, t0) do { if (stats_enabled) stats_stage_end((stage), (t0)); } while (0)
+#define STATS_COUNT(counter, n) do { if (stats_enabled) stats_current.counters[(counter)] += (uint64_t)(n); } while (0)
+#else
+#define STATS_BEGIN(t0) double t0 = 0.0
+#define STATS_END(stage, t0) ((void)(t0))
+#define STATS_COUNT(counter, n) ((void)0)
+#endif
@@ -0,0 +1,18 @@
+#pragma once
+#include "common.h"
+
+// calendar math and timestamp parsing without strptime/mktime, all UTC
+
+int64_t days_from_civil(int y, int m, int d);
+void civil_from_days(int64_t days, int *y, int *m, int *d);
+
+// fixed layout YYYY-MM-DD[T ]HH:MM:SS[.fff...][Z|+HH:MM|-HH:MM]
+// parses exactly [p, p+len), trailing spaces/CR allowed, epoch seconds in *out
+bool parse_iso8601(const char *p, size_t len, double *out);
+
+// tick positions snapped to human boundaries (seconds, minutes, hours, days, months, years)
+// returns number of ticks written, *step is the nominal spacing in seconds
+int time_ticks(double tmin, double tmax, int max_ticks, double *out, int out_cap, double *step);
+
+// label for a tick, format picked from the step ("HH:MM", "MM-DD", ...)
+int format_time_label(char *buf, size_t size, double t, double step);
@@ -0,0 +1,21 @@
+#pragma once
+#include "common.h"
+
+#define WATCH_MAX_FILES 64
+#define WATCH_MAX_NAME 256
+
+// change notification for files that are appended to or replaced
+// the parent directories are watched, so a file renamed over or recreated
+// (log rotation) is reported like one written in place
+typedef struct {
+    int fd;                 // readable when events are queued, -1 when closed
+    int count;
+    int dirs[WATCH_MAX_FILES];                  // watch descriptor of each file's directory
+    char names[WATCH_MAX_FILES][WATCH_MAX_NAME]; // base names
+} Watcher;
+
+int watch_open(Watcher *w);                     // 0 on success, -1 where inotify is missing
+int watch_add(Watcher *w, const char *path);    // 0 on success, adding a file twice is fine
+void watch_reset(Watcher *w);                   // forget the files, keep the descriptor
+bool watch_drain(Watcher *w);                   // read queued events, true if any is about a watched file
+void watch_close(Watcher *w);
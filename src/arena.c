@@ -0,0 +1,57 @@
+#include "../include/common.h"
+#include "../include/arena.h"
+
+#define ARENA_BLOCK_SIZE (16 * 1024)
+
+static size_t align_up(size_t n) {
+    size_t a = sizeof(max_align_t);
+    return (n + a - 1) / a * a;
+}
+
+void *arena_alloc(Arena *a, size_t size) {
+    size = align_up(size ? size : 1);
+
+    // first block with room, blocks past cur are empty after a reset
+    while (a->cur && a->cur->cap - a->cur->used < size) {
+        if (!a->cur->next) break;
+        a->cur = a->cur->next;
+    }
+
+    if (!a->cur || a->cur->cap - a->cur->used < size) {
+        size_t cap = size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE;
+        ArenaBlock *b = (ArenaBlock*)xmalloc(sizeof(ArenaBlock) + cap);
+        b->next = NULL;
+        b->used = 0;
+        b->cap = cap;
+
+        if (a->cur) a->cur->next = b;
+        else a->first = b;
+        a->cur = b;
+    }
+
+    void *p = (unsigned char*)a->cur->data + a->cur->used;
+    a->cur->used += size;
+    return p;
+}
+
+char *arena_strdup(Arena *a, const char *s) {
+    size_t n = strlen(s) + 1;
+    char *p = (char*)arena_alloc(a, n);
+    memcpy(p, s, n);
+    return p;
+}
+
+void arena_reset(Arena *a) {
+    for (ArenaBlock *b = a->first; b; b = b->next) b->used = 0;
+    a->cur = a->first;
+}
+
+void arena_free(Arena *a) {
+    ArenaBlock *b = a->first;
+    while (b) {
+        ArenaBlock *next = b->next;
+        free(b);
+        b = next;
+    }
+    a->first = a->cur = NULL;
+}
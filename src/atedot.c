@@ -1,4 +1,9 @@
 #include "../include/common.h"
+#include "../include/atedot.h"
+#include "../include/stats.h"
+#include "../include/timefmt.h"
+
+_Thread_local uint64_t atedot_alloc_count = 0;
 
 // braille
 // map (col, row) in a 2x4 cell to braille bit index
@@ -34,26 +39,21 @@ static int utf8_encode(uint32_t cp, char out[4]) {
     }
 }
 
-static void print_cell(uint8_t mask) {
+// both return bytes written
+static size_t print_cell(FILE *out, uint8_t mask) {
     char buf[4]; int n = utf8_encode(braille_cp(mask), buf);
-    fwrite(buf, 1, (size_t)n, stdout);
+    return fwrite(buf, 1, (size_t)n, out);
 }
 
-static void print_cell_with_color(uint8_t mask, uint32_t color) {
+static size_t print_cell_with_color(FILE *out, uint8_t mask, uint32_t color) {
     char buf[4]; int n = utf8_encode(braille_cp(mask), buf);
-    printf("\x1b[38;2;%d;%d;%dm", (color >> 16) & 0xFF, (color >> 8) & 0xFF, color & 0xFF); // set fg color
-    fwrite(buf, 1, (size_t)n, stdout);
-    printf("\x1b[0m"); // reset
+    int esc = fprintf(out, "\x1b[38;2;%d;%d;%dm", (color >> 16) & 0xFF, (color >> 8) & 0xFF, color & 0xFF); // set fg color
+    size_t bytes = fwrite(buf, 1, (size_t)n, out);
+    fputs("\x1b[0m", out); // reset
+    return bytes + (esc > 0 ? (size_t)esc : 0) + 4;
 }
 
 // canvas
-typedef struct {
-    int px_w, px_h;         // pixel-space size
-    int cell_w, cell_h;     // braille character grid
-    uint8_t *cells;         // bits map to braille dots
-    uint32_t *colors;       // color per pixel
-} Canvas;
-
 static uint32_t cell_color(const Canvas *surf, int x, int y) {
     uint8_t mask = surf->cells[y * surf->cell_w + x];
     if (mask == 0) return 0xFFFFFF;
@@ -80,29 +80,41 @@ Canvas canvas_make(int px_w, int px_h) {
     surf.cell_w = (px_w + 1) / 2;  // ceil(px_w / 2)
     surf.cell_h = (px_h + 3) / 4;  // ceil(px_h / 4)
 
-    size_t n = (size_t)surf.cell_w * (size_t)surf.cell_h;
+    surf.cells_cap = (size_t)surf.cell_w * (size_t)surf.cell_h;
+    surf.colors_cap = (size_t)px_w * (size_t)px_h;
 
-    surf.cells = (uint8_t*)calloc(n, 1);
-    surf.colors = (uint32_t*)calloc((size_t)px_w * (size_t)px_h, sizeof(uint32_t));
+    surf.cells = CALLOC(uint8_t, surf.cells_cap);
+    surf.colors = CALLOC(uint32_t, surf.colors_cap);
     return surf;
 }
 
 void canvas_resize(Canvas *surf, int new_w, int new_h) {
-    free(surf->cells);
-    free(surf->colors);
-
     surf->px_w = new_w;
     surf->px_h = new_h;
     surf->cell_w = (new_w + 1) / 2;
     surf->cell_h = (new_h + 3) / 4;
 
-    surf->cells = (uint8_t*)calloc((size_t)(surf->cell_w * surf->cell_h), sizeof(uint8_t));
-    surf->colors = (uint32_t*)calloc((size_t)(surf->px_w * surf->px_h), sizeof(uint32_t));
+    size_t n_cells = (size_t)surf->cell_w * (size_t)surf->cell_h;
+    size_t n_colors = (size_t)surf->px_w * (size_t)surf->px_h;
+
+    // shrinking or resizing back reuses the buffers
+    if (n_cells > surf->cells_cap) {
+        free(surf->cells);
+        surf->cells = CALLOC(uint8_t, n_cells);
+        surf->cells_cap = n_cells;
+    }
+    if (n_colors > surf->colors_cap) {
+        free(surf->colors);
+        surf->colors = CALLOC(uint32_t, n_colors);
+        surf->colors_cap = n_colors;
+    }
+    canvas_clear(surf);
 }
 
 void canvas_free(Canvas *surf) {
     free(surf->cells); surf->cells = NULL;
     free(surf->colors); surf->colors = NULL;
+    surf->cells_cap = surf->colors_cap = 0;
 }
 
 void canvas_clear(Canvas *surf) {
@@ -119,6 +131,7 @@ void canvas_pixel_set(Canvas *surf, int x, int y, uint32_t color) {
 
     surf->cells[cy * surf->cell_w + cx] |= (1u << bit);
     surf->colors[y * surf->px_w + x] = color;
+    STATS_COUNT(COUNTER_PIXELS, 1);
 }
 
 // unset pixel
@@ -132,58 +145,181 @@ void canvas_pixel_unset(Canvas *surf, int x, int y) {
     surf->colors[y * surf->px_w + x] = 0;
 }
 
-// to stdout
-// dump to stdout with utf-8 braille and space for the rest
-void render_row(const Canvas *surf, int y, bool use_color) {
+// to stream
+#define AXIS_PAD 8  // y label gutter
+#define PANE_GAP 2  // columns between panes of a grid
+
+static size_t put_spaces(FILE *out, int n) {
+    for (int i = 0; i < n; i++) putc(' ', out);
+    return n > 0 ? (size_t)n : 0;
+}
+
+// whether a label starting at `col` ends inside the pane, anything fits if width < 0
+// a label that doesn't is dropped, a cut one would read as a different number
+static bool label_fits(int col, int len, int width) {
+    return width < 0 || col + len <= width;
+}
+
+// one row of cells without the newline
+static size_t render_cells_to(FILE *out, const Canvas *surf, int y, bool use_color) {
+    size_t bytes = 0;
     for (int x = 0; x < surf->cell_w; ++x) {
         uint8_t mask = surf->cells[y * surf->cell_w + x];
-        if (!mask) { putchar(' '); continue; }
+        if (!mask) { putc(' ', out); bytes++; continue; }
 
         if (use_color) {
             uint32_t color = cell_color(surf, x, y);
-            print_cell_with_color(mask, color);
-        } else print_cell(mask);
+            bytes += print_cell_with_color(out, mask, color);
+        } else bytes += print_cell(out, mask);
     }
-    putchar('\n');
+    return bytes;
 }
 
-void render_full(const Canvas *surf, bool use_color) {
+// dump to out with utf-8 braille and space for the rest, return bytes written
+size_t render_row_to(FILE *out, const Canvas *surf, int y, bool use_color) {
+    size_t bytes = render_cells_to(out, surf, y, use_color);
+    putc('\n', out);
+    return bytes + 1;
+}
+
+size_t render_full_to(FILE *out, const Canvas *surf, bool use_color) {
+    size_t bytes = 0;
     for (int y = 0; y < surf->cell_h; ++y) {
-        render_row(surf, y, use_color);
+        bytes += render_row_to(out, surf, y, use_color);
     }
+    return bytes;
 }
 
-void render_full_w_axes(const Canvas *surf,
-                     double xmin, double xmax, double ymin, double ymax,
+// y label in front of cell row y, blank between ticks
+static size_t render_y_label(FILE *out, const Canvas *surf, int y, double ymin, double ymax, int y_ticks) {
+    int y_step = surf->cell_h / (y_ticks - 1);
+    if (y_step < 1) y_step = 1;
+
+    int n;
+    if (y % y_step == 0 || y == surf->cell_h - 1) {
+        char buf[64];
+        double yval = ymax - (y / (double)(surf->cell_h - 1)) * (ymax - ymin);
+        snprintf(buf, sizeof(buf), "%.2f", yval);
+        n = fprintf(out, "%*s ", AXIS_PAD - 1, buf);
+    } else {
+        n = fprintf(out, "%*s ", AXIS_PAD - 1, "");
+    }
+    return n > 0 ? (size_t)n : 0;
+}
+
+// x labels on calendar boundaries, labels that would overlap are dropped
+static int render_time_axis(FILE *out, const Canvas *surf, double xmin, double xmax, int x_ticks, int width) {
+    double ticks[64], step;
+    int n = time_ticks(xmin, xmax, x_ticks, ticks, 64, &step);
+
+    char buf[32];
+    int col = 0, next = 0; // printed columns, earliest start of the next label
+    for (int k = 0; k < n; k++) {
+        int c = (int)((ticks[k] - xmin) / (xmax - xmin) * (surf->cell_w - 1) + 0.5);
+        if (c < next || c >= surf->cell_w) continue;
+
+        int len = format_time_label(buf, sizeof(buf), ticks[k], step);
+        if (len <= 0 || !label_fits(c, len, width)) continue;
+        col += (int)put_spaces(out, c - col);
+        fwrite(buf, 1, (size_t)len, out);
+        col += len;
+        next = c + len + 1;
+    }
+    return col;
+}
+
+// x axis of one pane, clipped and padded to `width` columns unless width < 0
+static size_t render_x_axis(FILE *out, const RenderPane *pane, int x_ticks, int width) {
+    const Canvas *surf = pane->surf;
+    int col = 0;
+
+    if (pane->time_axis) col = render_time_axis(out, surf, pane->xmin, pane->xmax, x_ticks, width);
+    else {
+        char buf[64];
+        int x_step = x_ticks > 1 ? surf->cell_w / (x_ticks - 1) : 0;
+        for (int i = 0; i < surf->cell_w; ++i) {
+            int len = 0;
+            if (x_step > 0 && i % x_step == 0) {
+                double xval = pane->xmin + (i / (double)(surf->cell_w - 1)) * (pane->xmax - pane->xmin);
+                len = snprintf(buf, sizeof(buf), "%.2f", xval);
+            }
+            if (len > 0 && label_fits(col, len, width)) {
+                fwrite(buf, 1, (size_t)len, out);
+                col += len;
+                i += len - 1;
+            } else if (width < 0 || col < width) { putc(' ', out); col++; }
+        }
+    }
+    if (width > col) col += (int)put_spaces(out, width - col);
+    return (size_t)col;
+}
+
+size_t render_grid_to(FILE *out, const RenderPane *panes, int rows, int cols,
                      int x_ticks, int y_ticks, bool use_color) {
+    STATS_BEGIN(t0);
+    size_t bytes = 0;
 
-    int pad = 8;
-    char buf[64];
-    int y_step = surf->cell_h / (y_ticks - 1);
+    for (int r = 0; r < rows; r++) {
+        const RenderPane *row = &panes[r * cols];
+        int h = 0;
+        for (int c = 0; c < cols; c++) {
+            if (row[c].surf->cell_h > h) h = row[c].surf->cell_h;
+        }
 
-    for (int y = 0; y < surf->cell_h; ++y) {
-        // print Y-axis labels
-        if (y % y_step == 0 || y == surf->cell_h - 1) {
-            double yval = ymax - (y / (double)(surf->cell_h - 1)) * (ymax - ymin);
-            snprintf(buf, sizeof(buf), "%.2f", yval);
-            printf("%*s ", pad-1, buf);
-        } else {
-            printf("%*s ", pad-1, "");
+        // cell rows side by side, each pane behind its own y labels
+        for (int y = 0; y < h; ++y) {
+            for (int c = 0; c < cols; c++) {
+                const RenderPane *p = &row[c];
+                if (c > 0) bytes += put_spaces(out, PANE_GAP);
+                if (y < p->surf->cell_h) {
+                    bytes += render_y_label(out, p->surf, y, p->ymin, p->ymax, y_ticks);
+                    bytes += render_cells_to(out, p->surf, y, use_color);
+                } else if (c + 1 < cols) bytes += put_spaces(out, AXIS_PAD + p->surf->cell_w);
+            }
+            putc('\n', out);
+            bytes++;
         }
 
-        render_row(surf, y, use_color);
+        // x axes, all but the last one clipped to their pane
+        for (int c = 0; c < cols; c++) {
+            if (c > 0) bytes += put_spaces(out, PANE_GAP);
+            bytes += put_spaces(out, AXIS_PAD);
+            bytes += render_x_axis(out, &row[c], x_ticks, c + 1 < cols ? row[c].surf->cell_w : -1);
+        }
+        putc('\n', out);
+        bytes++;
     }
 
-    // print X-axis
-    printf("%*s", pad, "");
-    for (int i = 0; i < surf->cell_w; ++i) {
-        if (x_ticks > 1 && i % (surf->cell_w / (x_ticks - 1)) == 0) {
-            double xval = xmin + (i / (double)(surf->cell_w - 1)) * (xmax - xmin);
-            snprintf(buf, sizeof(buf), "%.2f", xval);
-            int len = (int)strlen(buf);
-            printf("%s", buf);
-            i += len - 1;
-        } else putchar(' ');
-    }
-    putchar('\n');
+    STATS_COUNT(COUNTER_BYTES, bytes);
+    STATS_END(STAGE_RENDER, t0);
+    return bytes;
+}
+
+size_t render_full_w_axes_to(FILE *out, const Canvas *surf,
+                     double xmin, double xmax, double ymin, double ymax,
+                     int x_ticks, int y_ticks, bool use_color) {
+    RenderPane pane = { surf, xmin, xmax, ymin, ymax, false };
+    return render_grid_to(out, &pane, 1, 1, x_ticks, y_ticks, use_color);
+}
+
+size_t render_full_w_time_axis_to(FILE *out, const Canvas *surf,
+                     double xmin, double xmax, double ymin, double ymax,
+                     int x_ticks, int y_ticks, bool use_color) {
+    RenderPane pane = { surf, xmin, xmax, ymin, ymax, true };
+    return render_grid_to(out, &pane, 1, 1, x_ticks, y_ticks, use_color);
+}
+
+// to stdout
+void render_row(const Canvas *surf, int y, bool use_color) {
+    render_row_to(stdout, surf, y, use_color);
+}
+
+void render_full(const Canvas *surf, bool use_color) {
+    render_full_to(stdout, surf, use_color);
+}
+
+void render_full_w_axes(const Canvas *surf,
+                     double xmin, double xmax, double ymin, double ymax,
+                     int x_ticks, int y_ticks, bool use_color) {
+    render_full_w_axes_to(stdout, surf, xmin, xmax, ymin, ymax, x_ticks, y_ticks, use_color);
 }
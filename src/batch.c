@@ -0,0 +1,166 @@
+#define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "../include/common.h"
+#include "../include/atedot.h"
+#include "../include/repl.h"
+#include "../include/batch.h"
+#include "../include/stats.h"
+
+#define BATCH_CANVAS_W 100
+#define BATCH_CANVAS_H 64
+#define BATCH_STEM 256
+
+typedef char Stem[BATCH_STEM];
+
+// "dir/chart.atd" -> "chart"
+static void script_stem(const char *path, char *out, size_t out_size) {
+    const char *base = strrchr(path, '/');
+    base = base ? base + 1 : path;
+
+    size_t len = strlen(base);
+    const char *dot = strrchr(base, '.');
+    if (dot && dot != base) len = (size_t)(dot - base);
+    if (len >= out_size) len = out_size - 1;
+
+    memcpy(out, base, len);
+    out[len] = '\0';
+}
+
+// frame file prefixes, one per script
+// scripts sharing a basename get their 1-based position in front ("3-chart"),
+// so concurrent workers never write the same files; false if names still clash
+static bool script_stems(char **scripts, int n, Stem *stems) {
+    Stem *bases = MALLOC(Stem, n);
+    for (int i = 0; i < n; i++) script_stem(scripts[i], bases[i], BATCH_STEM);
+
+    for (int i = 0; i < n; i++) {
+        bool shared = false;
+        for (int j = 0; j < n && !shared; j++) shared = j != i && strcmp(bases[i], bases[j]) == 0;
+        if (shared) snprintf(stems[i], BATCH_STEM, "%d-%.200s", i + 1, bases[i]);
+        else memcpy(stems[i], bases[i], BATCH_STEM);
+    }
+    free(bases);
+
+    for (int i = 0; i < n; i++) {
+        for (int j = i + 1; j < n; j++) {
+            if (strcmp(stems[i], stems[j]) != 0) continue;
+            fprintf(stderr, "Error: %s and %s would write the same frames (%s-NNNN.txt)\n",
+                    scripts[i], scripts[j], stems[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+// worker body, never returns
+static void run_worker(const char *script, const char *stem, const char *out_dir, bool use_color) {
+    if (stats_trace_path()) {
+        char trace[1024];
+        snprintf(trace, sizeof(trace), "%s.%ld", stats_trace_path(), (long)getpid());
+        stats_trace_start(trace);
+    }
+
+    Canvas surf = canvas_make(BATCH_CANVAS_W, BATCH_CANVAS_H);
+    int frames = repl_run_script(&surf, script, out_dir, stem, use_color);
+    canvas_free(&surf);
+
+    if (stats_trace_path()) stats_trace_finish();
+
+    fflush(NULL);
+    _exit(frames < 0 ? 1 : 0);
+}
+
+// reap one finished worker, false if none left
+static bool reap_worker(int *failed) {
+    int status;
+    pid_t pid;
+    do pid = wait(&status);
+    while (pid < 0 && errno == EINTR);
+
+    if (pid < 0) return false;
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) (*failed)++;
+    return true;
+}
+
+int batch_run(char **scripts, int n_scripts, const char *out_dir, int jobs, bool use_color) {
+    if (out_dir && mkdir(out_dir, 0755) != 0 && errno != EEXIST) {
+        perror(out_dir);
+        return n_scripts;
+    }
+
+    Stem *stems = MALLOC(Stem, n_scripts > 0 ? n_scripts : 1);
+    if (!script_stems(scripts, n_scripts, stems)) {
+        free(stems);
+        return n_scripts;
+    }
+
+    // interleaved frames on stdout are useless, serialise
+    if (!out_dir || jobs < 1) jobs = 1;
+
+    int failed = 0, running = 0;
+    fflush(NULL); // don't let children inherit pending output
+
+    for (int i = 0; i < n_scripts; i++) {
+        if (running >= jobs && reap_worker(&failed)) running--;
+
+        pid_t pid = fork();
+        if (pid == 0) run_worker(scripts[i], stems[i], out_dir, use_color);
+        if (pid < 0) {
+            perror("fork");
+            failed++;
+            continue;
+        }
+        running++;
+    }
+
+    while (running > 0 && reap_worker(&failed)) running--;
+    free(stems);
+    return failed;
+}
+
+char **batch_read_manifest(const char *path, int *out_count) {
+    *out_count = 0;
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return NULL;
+    }
+
+    int count = 0, cap = 64;
+    char **scripts = MALLOC(char*, cap);
+    char line[1024];
+
+    while (fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\r\n")] = '\0';
+
+        char *p = line;
+        while (*p == ' ' || *p == '\t') p++;
+        if (*p == '\0' || *p == '#') continue;
+
+        if (count == cap) {
+            cap *= 2;
+            char **grown = REALLOC(char*, scripts, cap);
+            if (!grown) {
+                fprintf(stderr, "Fatal: Out of memory\n");
+                exit(1);
+            }
+            scripts = grown;
+        }
+        scripts[count] = MALLOC(char, strlen(p) + 1);
+        strcpy(scripts[count], p);
+        count++;
+    }
+
+    fclose(f);
+    *out_count = count;
+    return scripts;
+}
+
+void batch_free_manifest(char **scripts, int n_scripts) {
+    for (int i = 0; i < n_scripts; i++) free(scripts[i]);
+    free(scripts);
+}
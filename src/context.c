@@ -0,0 +1,122 @@
+#define _POSIX_C_SOURCE 200809L
+#include "../include/common.h"
+#include "../include/atedot.h"
+#include "../include/plots.h"
+
+struct AtedotContext {
+    Canvas surf;
+    double xmin, xmax, ymin, ymax;
+    bool view_locked;       // set by ctx_set_view, csv plots leave it alone
+    bool time_axis;
+    bool use_color;
+    int x_ticks, y_ticks;
+
+    PlotRegistry plots;
+    ParamTable params;
+
+    bool dirty;             // canvas is stale
+
+    FILE *frame;            // rendered frame, rewound between renders
+    char *frame_data;
+    size_t frame_size;
+};
+
+AtedotContext *ctx_make(int px_w, int px_h) {
+    AtedotContext *ctx = CALLOC(AtedotContext, 1);
+    ctx->surf = canvas_make(px_w, px_h);
+    ctx->xmin = -10; ctx->xmax = 10;
+    ctx->ymin = -5;  ctx->ymax = 5;
+    ctx->use_color = true;
+    ctx->x_ticks = 5;
+    ctx->y_ticks = 5;
+    return ctx;
+}
+
+void ctx_clear(AtedotContext *ctx) {
+    plots_clear(&ctx->plots);
+    ctx->dirty = true;
+}
+
+void ctx_free(AtedotContext *ctx) {
+    if (!ctx) return;
+    plots_free(&ctx->plots);
+    canvas_free(&ctx->surf);
+    if (ctx->frame) fclose(ctx->frame);
+    free(ctx->frame_data);
+    free(ctx);
+}
+
+void ctx_resize(AtedotContext *ctx, int px_w, int px_h) {
+    canvas_resize(&ctx->surf, px_w, px_h);
+    ctx->dirty = true;
+}
+
+void ctx_set_view(AtedotContext *ctx, double xmin, double xmax, double ymin, double ymax) {
+    ctx->xmin = xmin; ctx->xmax = xmax;
+    ctx->ymin = ymin; ctx->ymax = ymax;
+    ctx->view_locked = true;
+    ctx->dirty = true;
+}
+
+void ctx_set_ticks(AtedotContext *ctx, int x_ticks, int y_ticks) {
+    if (x_ticks > 1) ctx->x_ticks = x_ticks;
+    if (y_ticks > 1) ctx->y_ticks = y_ticks;
+}
+
+void ctx_set_color(AtedotContext *ctx, bool use_color) {
+    ctx->use_color = use_color;
+}
+
+void ctx_set_time_axis(AtedotContext *ctx, bool time_axis) {
+    ctx->time_axis = time_axis;
+}
+
+int ctx_set_param(AtedotContext *ctx, const char *name, double value) {
+    if (!params_set(&ctx->params, name, value)) return -1;
+    ctx->dirty = true;
+    return 0;
+}
+
+int ctx_plot_expr(AtedotContext *ctx, const char *expr, uint32_t color) {
+    if (!plots_add_expr(&ctx->plots, &ctx->params, expr, color)) return -1;
+    ctx->dirty = true;
+    return 0;
+}
+
+// an unlocked view is fitted to every csv plot in turn, so the last one wins
+int ctx_plot_csv(AtedotContext *ctx, const char *path, int xcol, int ycol, uint32_t color) {
+    PlotCmd *cmd = plots_add_csv(&ctx->plots, path, xcol, ycol, 0, color);
+    if (!cmd) return -1;
+
+    if (!ctx->view_locked) {
+        ctx->xmin = cmd->series.xmin; ctx->xmax = cmd->series.xmax;
+        ctx->ymin = cmd->series.ymin; ctx->ymax = cmd->series.ymax;
+    }
+    if (cmd->series.x_time) ctx->time_axis = true;
+    ctx->dirty = true;
+    return 0;
+}
+
+size_t ctx_render_to_buffer(AtedotContext *ctx, char *buf, size_t cap) {
+    if (ctx->dirty) {
+        plots_draw(&ctx->plots, &ctx->params, &ctx->surf, ctx->xmin, ctx->xmax, ctx->ymin, ctx->ymax);
+        ctx->dirty = false;
+    }
+
+    if (!ctx->frame && !(ctx->frame = open_memstream(&ctx->frame_data, &ctx->frame_size))) {
+        if (cap) buf[0] = '\0';
+        return 0;
+    }
+    rewind(ctx->frame);
+    RenderPane pane = { &ctx->surf, ctx->xmin, ctx->xmax, ctx->ymin, ctx->ymax, ctx->time_axis };
+    render_grid_to(ctx->frame, &pane, 1, 1, ctx->x_ticks, ctx->y_ticks, ctx->use_color);
+    fflush(ctx->frame);
+    size_t len = (size_t)ftell(ctx->frame);
+
+    if (cap) {
+        size_t n = len < cap ? len : cap - 1;
+        memcpy(buf, ctx->frame_data, n);
+        buf[n] = '\0';
+    }
+    return len;
+}
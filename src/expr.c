@@ -2,118 +2,269 @@
 #include "../include/expr.h"
 #include <ctype.h>
 
-// recursive parser
+// recursive compiler to a postfix program
 // expr   -> term { (+|-) term }
 // term   -> factor { (*|/|^) factor }
-// factor -> (expr) | number | -factor | func(expr) | x
+// factor -> (expr) | number | -factor | func(expr) | x | name
 
-static const char *pos;
-static double current_x;
-static int *err_flag;
+typedef enum {
+    OP_CONST, OP_X, OP_PARAM, OP_NEG,
+    OP_ADD, OP_SUB, OP_MUL, OP_DIV, OP_POW,
+    OP_SIN, OP_COS, OP_TAN, OP_EXP, OP_LOG, OP_ABS, OP_SQRT
+} ExprOp;
 
-static double parse_expr(void);
+static const struct {
+    const char *name;
+    ExprOp op;
+} funcs[] = {
+    { "sin", OP_SIN }, { "cos", OP_COS }, { "tan", OP_TAN }, { "exp", OP_EXP },
+    { "log", OP_LOG }, { "abs", OP_ABS }, { "sqrt", OP_SQRT }
+};
 
-static void skip_spaces(void) {
-    while (isspace((unsigned char)*pos)) pos++;
+// compiler state lives on the caller's stack, so compiling is reentrant
+typedef struct {
+    const char *pos;
+    const char *var;    // name of the free variable
+    ExprProgram *prog;
+    int depth;          // stack depth after the code emitted so far
+    int err;
+} Compiler;
+
+static void compile_expr(Compiler *c);
+
+static void skip_spaces(Compiler *c) {
+    while (isspace((unsigned char)*c->pos)) c->pos++;
+}
+
+// `effect` is the change in stack depth: +1 push, -1 binary op, 0 unary op
+static void emit(Compiler *c, ExprOp op, int arg, double value, int effect) {
+    ExprProgram *prog = c->prog;
+    if (prog->len == EXPR_MAX_CODE) { c->err = 1; return; }
+
+    ExprInstr *in = &prog->code[prog->len++];
+    in->op = (uint8_t)op;
+    in->arg = (uint8_t)arg;
+    in->value = value;
+
+    c->depth += effect;
+    if (c->depth > EXPR_MAX_STACK) c->err = 1;
 }
 
-static double parse_factor(void) {
-    skip_spaces();
-    double v = 0.0;
+// parameters get slots in order of first use
+static int param_slot(Compiler *c, const char *name) {
+    ExprProgram *prog = c->prog;
+    for (int i = 0; i < prog->n_params; i++) {
+        if (strcmp(prog->params[i], name) == 0) return i;
+    }
+    if (prog->n_params == EXPR_MAX_PARAMS) { c->err = 1; return 0; }
+    strcpy(prog->params[prog->n_params], name);
+    return prog->n_params++;
+}
 
-    if (*pos == '(') {
-        pos++;
-        v = parse_expr();
-        skip_spaces();
-        if (*pos == ')') pos++;
-        else *err_flag = 1;
+static void compile_factor(Compiler *c) {
+    skip_spaces(c);
+
+    if (*c->pos == '(') {
+        c->pos++;
+        compile_expr(c);
+        skip_spaces(c);
+        if (*c->pos == ')') c->pos++;
+        else c->err = 1;
     }
-    else if (isdigit((unsigned char)*pos) || *pos == '.') {
+    else if (isdigit((unsigned char)*c->pos) || *c->pos == '.') {
         char *end;
-        v = strtod(pos, &end);
-        if (pos == end) *err_flag = 1;
-        pos = end;
-    }
-    else if (*pos == 'x') {
-        pos++;
-        v = current_x;
+        double v = strtod(c->pos, &end);
+        if (c->pos == end) c->err = 1;
+        c->pos = end;
+        emit(c, OP_CONST, 0, v, 1);
     }
-    else if (*pos == '-') {
-        pos++;
-        v = -parse_factor();
+    else if (*c->pos == '-') {
+        c->pos++;
+        compile_factor(c);
+        emit(c, OP_NEG, 0, 0, 0);
     }
-    else if (isalpha((unsigned char)*pos)) {
-        // func: sin, cos, tan, exp, log, abs, sqrt
-        char func[5] = {0};
+    else if (isalpha((unsigned char)*c->pos)) {
+        // identifier: x, a function call or a parameter
+        char name[EXPR_MAX_NAME];
         int i = 0;
-        while (isalpha((unsigned char)*pos) && i < 4) func[i++] = *pos++;
-
-        skip_spaces();
-        if (*pos == '(') {
-            pos++;
-            double arg = parse_expr();
-            skip_spaces();
-            if (*pos == ')') pos++;
-            else *err_flag = 1;
-
-            if (strcmp(func, "sin") == 0) v = sin(arg);
-            else if (strcmp(func, "cos") == 0) v = cos(arg);
-            else if (strcmp(func, "tan") == 0) v = tan(arg);
-            else if (strcmp(func, "exp") == 0) v = exp(arg);
-            else if (strcmp(func, "log") == 0) v = log(arg);
-            else if (strcmp(func, "abs") == 0) v = fabs(arg);
-            else if (strcmp(func, "sqrt") == 0) v = sqrt(arg);
-            else *err_flag = 1; // unknown function
-        } else {
-            *err_flag = 1;
+        while (isalnum((unsigned char)*c->pos) || *c->pos == '_') {
+            if (i == EXPR_MAX_NAME - 1) { c->err = 1; break; }
+            name[i++] = *c->pos++;
         }
+        name[i] = '\0';
+
+        skip_spaces(c);
+        if (strcmp(name, c->var) == 0) emit(c, OP_X, 0, 0, 1);
+        else if (*c->pos == '(') {
+            c->pos++;
+            compile_expr(c);
+            skip_spaces(c);
+            if (*c->pos == ')') c->pos++;
+            else c->err = 1;
+
+            size_t f = 0, n_funcs = sizeof(funcs) / sizeof(funcs[0]);
+            while (f < n_funcs && strcmp(funcs[f].name, name) != 0) f++;
+            if (f < n_funcs) emit(c, funcs[f].op, 0, 0, 0);
+            else c->err = 1; // unknown function
+        }
+        else emit(c, OP_PARAM, param_slot(c, name), 0, 1);
     }
     else {
-        *err_flag = 1; // unexpected char
+        c->err = 1; // unexpected char
     }
 
     // handle ^ immediately after factor
-    skip_spaces();
-    if (*pos == '^') {
-        pos++;
-        double exponent = parse_factor();
-        v = pow(v, exponent);
+    skip_spaces(c);
+    if (*c->pos == '^') {
+        c->pos++;
+        compile_factor(c);
+        emit(c, OP_POW, 0, 0, -1);
     }
+}
 
-    return v;
+static void compile_term(Compiler *c) {
+    compile_factor(c);
+    skip_spaces(c);
+    while (*c->pos == '*' || *c->pos == '/') {
+        char op = *c->pos++;
+        compile_factor(c);
+        emit(c, op == '*' ? OP_MUL : OP_DIV, 0, 0, -1);
+    }
 }
 
-static double parse_term(void) {
-    double v = parse_factor();
-    skip_spaces();
-    while (*pos == '*' || *pos == '/') {
-        char op = *pos++;
-        double rhs = parse_factor();
-        if (op == '*') v *= rhs;
-        else if (rhs != 0.0) v /= rhs;
-        else { v = NAN; *err_flag = 1; } // div by zero
+static void compile_expr(Compiler *c) {
+    compile_term(c);
+    skip_spaces(c);
+    while (*c->pos == '+' || *c->pos == '-') {
+        char op = *c->pos++;
+        compile_term(c);
+        emit(c, op == '+' ? OP_ADD : OP_SUB, 0, 0, -1);
     }
-    return v;
 }
 
-static double parse_expr(void) {
-    double v = parse_term();
-    skip_spaces();
-    while (*pos == '+' || *pos == '-') {
-        char op = *pos++;
-        double rhs = parse_term();
-        if (op == '+') v += rhs;
-        else v -= rhs;
+int expr_compile(ExprProgram *prog, const char *expression) {
+    return expr_compile_var(prog, expression, "x");
+}
+
+int expr_compile_var(ExprProgram *prog, const char *expression, const char *var) {
+    prog->len = 0;
+    prog->n_params = 0;
+
+    Compiler c = { expression, var, prog, 0, 0 };
+    compile_expr(&c);
+    skip_spaces(&c);
+    if (*c.pos != '\0') c.err = 1; // trailing input, e.g. "sin(x) 2"
+    if (c.err) {
+        prog->len = 0; // never run half a program
+        return -1;
     }
-    return v;
+    return 0;
 }
 
-double expr_eval(const char *expression, double x, int *error) {
-    pos = expression;
-    current_x = x;
-    if (error) *error = 0;
-    else { int dummy; err_flag = &dummy; } // safe fallback
-    err_flag = error;
+int expr_param_index(const ExprProgram *prog, const char *name) {
+    for (int i = 0; i < prog->n_params; i++) {
+        if (strcmp(prog->params[i], name) == 0) return i;
+    }
+    return -1;
+}
+
+double expr_run(const ExprProgram *prog, double x, const double *params, int *error) {
+    double st[EXPR_MAX_STACK];
+    int sp = 0, err = prog->len == 0;
+
+    for (int i = 0; i < prog->len; i++) {
+        const ExprInstr *in = &prog->code[i];
+        switch ((ExprOp)in->op) {
+            case OP_CONST: st[sp++] = in->value; break;
+            case OP_X:     st[sp++] = x; break;
+            case OP_PARAM:
+                if (params) st[sp++] = params[in->arg];
+                else { st[sp++] = NAN; err = 1; } // unbound
+                break;
+            case OP_NEG: st[sp - 1] = -st[sp - 1]; break;
+            case OP_ADD: sp--; st[sp - 1] += st[sp]; break;
+            case OP_SUB: sp--; st[sp - 1] -= st[sp]; break;
+            case OP_MUL: sp--; st[sp - 1] *= st[sp]; break;
+            case OP_DIV:
+                sp--;
+                if (st[sp] != 0.0) st[sp - 1] /= st[sp];
+                else { st[sp - 1] = NAN; err = 1; } // div by zero
+                break;
+            case OP_POW:  sp--; st[sp - 1] = pow(st[sp - 1], st[sp]); break;
+            case OP_SIN:  st[sp - 1] = sin(st[sp - 1]); break;
+            case OP_COS:  st[sp - 1] = cos(st[sp - 1]); break;
+            case OP_TAN:  st[sp - 1] = tan(st[sp - 1]); break;
+            case OP_EXP:  st[sp - 1] = exp(st[sp - 1]); break;
+            case OP_LOG:  st[sp - 1] = log(st[sp - 1]); break;
+            case OP_ABS:  st[sp - 1] = fabs(st[sp - 1]); break;
+            case OP_SQRT: st[sp - 1] = sqrt(st[sp - 1]); break;
+        }
+    }
+
+    if (error) *error = err;
+    return sp ? st[0] : NAN;
+}
+
+// one instruction at a time over a whole block, the loops are simple enough to vectorise
+// errors are not reported, failed samples come out as NaN or inf
+void expr_run_batch(const ExprProgram *prog, const double *x, double *out, int n, const double *params) {
+    double st[EXPR_MAX_STACK][EXPR_BATCH];
+
+    for (int base = 0; base < n; base += EXPR_BATCH) {
+        int m = n - base < EXPR_BATCH ? n - base : EXPR_BATCH;
+        const double *xs = x + base;
+        int sp = 0;
 
-    return parse_expr();
+        for (int i = 0; i < prog->len; i++) {
+            const ExprInstr *in = &prog->code[i];
+            if (in->op == OP_CONST || in->op == OP_X || in->op == OP_PARAM) {
+                double *d = st[sp++];
+                if (in->op == OP_X) memcpy(d, xs, (size_t)m * sizeof(double));
+                else {
+                    double v = in->op == OP_CONST ? in->value : params ? params[in->arg] : NAN;
+                    for (int j = 0; j < m; j++) d[j] = v;
+                }
+                continue;
+            }
+
+            double *a = st[sp - 1];
+            if (in->op >= OP_ADD && in->op <= OP_POW) {
+                const double *b = st[--sp];
+                a = st[sp - 1];
+                switch ((ExprOp)in->op) {
+                    case OP_ADD: for (int j = 0; j < m; j++) a[j] += b[j]; break;
+                    case OP_SUB: for (int j = 0; j < m; j++) a[j] -= b[j]; break;
+                    case OP_MUL: for (int j = 0; j < m; j++) a[j] *= b[j]; break;
+                    case OP_DIV: for (int j = 0; j < m; j++) a[j] = b[j] != 0.0 ? a[j] / b[j] : NAN; break;
+                    case OP_POW: for (int j = 0; j < m; j++) a[j] = pow(a[j], b[j]); break;
+                    default: break;
+                }
+                continue;
+            }
+
+            switch ((ExprOp)in->op) {
+                case OP_NEG:  for (int j = 0; j < m; j++) a[j] = -a[j]; break;
+                case OP_SIN:  for (int j = 0; j < m; j++) a[j] = sin(a[j]); break;
+                case OP_COS:  for (int j = 0; j < m; j++) a[j] = cos(a[j]); break;
+                case OP_TAN:  for (int j = 0; j < m; j++) a[j] = tan(a[j]); break;
+                case OP_EXP:  for (int j = 0; j < m; j++) a[j] = exp(a[j]); break;
+                case OP_LOG:  for (int j = 0; j < m; j++) a[j] = log(a[j]); break;
+                case OP_ABS:  for (int j = 0; j < m; j++) a[j] = fabs(a[j]); break;
+                case OP_SQRT: for (int j = 0; j < m; j++) a[j] = sqrt(a[j]); break;
+                default: break;
+            }
+        }
+
+        if (sp) memcpy(out + base, st[0], (size_t)m * sizeof(double));
+        else for (int j = 0; j < m; j++) out[base + j] = NAN;
+    }
+}
+
+double expr_eval(const char *expression, double x, int *error) {
+    ExprProgram prog;
+    if (expr_compile(&prog, expression) != 0) {
+        if (error) *error = 1;
+        return NAN;
+    }
+    return expr_run(&prog, x, NULL, error);
 }
@@ -1,15 +1,82 @@
+#define _POSIX_C_SOURCE 200809L
+#include <unistd.h>
 #include "../include/common.h"
 #include "../include/atedot.h"
 #include "../include/expr.h"
 #include "../include/repl.h"
+#include "../include/batch.h"
+#include "../include/stats.h"
 
-int main() {
+static void usage(const char *prog) {
+    fprintf(stderr,
+        "usage: %s [--trace <out.json>]  interactive REPL\n"
+        "       %s --script <file.atd> [--script ...] [--manifest <list>]\n"
+        "          [--out <dir>] [-j <jobs>] [--no-color] [--trace <out.json>]\n",
+        prog, prog);
+}
+
+int main(int argc, char **argv) {
     setlocale(LC_ALL, "");
 
-    Canvas surf = canvas_make(100, 64);    // 80x24 terminal pixels
+    char **scripts = CALLOC(char*, argc);
+    int n_scripts = 0;
+    char **manifest = NULL;
+    int n_manifest = 0;
+    const char *out_dir = NULL;
+    const char *trace = NULL;
+    int jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    bool use_color = true;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--script") == 0 && i + 1 < argc) scripts[n_scripts++] = argv[++i];
+        else if (strcmp(argv[i], "--manifest") == 0 && i + 1 < argc && !manifest) {
+            manifest = batch_read_manifest(argv[++i], &n_manifest);
+            if (!manifest) { free(scripts); return 1; }
+        }
+        else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) out_dir = argv[++i];
+        else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) jobs = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--no-color") == 0) use_color = false;
+        else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) trace = argv[++i];
+        else {
+            usage(argv[0]);
+            free(scripts);
+            if (manifest) batch_free_manifest(manifest, n_manifest);
+            return 2;
+        }
+    }
+
+    // trace path is kept by the batch workers, each writes <trace>.<pid>
+    if (trace) stats_trace_start(trace);
+
+    if (n_scripts == 0 && !manifest) {
+        Canvas surf = canvas_make(100, 64);    // 80x24 terminal pixels
+
+        repl(&surf);    // interactive REPL
+
+        canvas_free(&surf);
+        free(scripts);
+        if (trace) stats_trace_finish();
+        return 0;
+    }
+
+    // --script and manifest entries share one worker pool
+    // an empty manifest is an empty batch, nothing to append
+    char **all = scripts;
+    if (n_manifest > 0) {
+        all = REALLOC(char*, scripts, n_scripts + n_manifest);
+        if (!all) {
+            fprintf(stderr, "Fatal: Out of memory\n");
+            free(scripts);
+            batch_free_manifest(manifest, n_manifest);
+            return 1;
+        }
+        memcpy(all + n_scripts, manifest, (size_t)n_manifest * sizeof(char*));
+    }
 
-    repl(&surf);    // interactive REPL
+    int failed = batch_run(all, n_scripts + n_manifest, out_dir, jobs, use_color);
+    if (manifest) batch_free_manifest(manifest, n_manifest);
+    free(all);
 
-    canvas_free(&surf);
-    return 0;
+    if (failed) fprintf(stderr, "%d script(s) failed\n", failed);
+    return failed ? 1 : 0;
 }
@@ -0,0 +1,224 @@
+#include "../include/common.h"
+#include "../include/atedot.h"
+#include "../include/plots.h"
+
+static const Param *param_lookup(const ParamTable *t, const char *name) {
+    for (int i = 0; i < t->count; i++) {
+        if (strcmp(t->items[i].name, name) == 0) return &t->items[i];
+    }
+    return NULL;
+}
+
+Param *params_find(ParamTable *t, const char *name) {
+    return (Param*)param_lookup(t, name);
+}
+
+Param *params_set(ParamTable *t, const char *name, double value) {
+    Param *p = params_find(t, name);
+    if (!p) {
+        if (t->count == PLOTS_MAX_PARAMS || strlen(name) >= EXPR_MAX_NAME) return NULL;
+        p = &t->items[t->count++];
+        strcpy(p->name, name);
+    }
+    p->value = value;
+    return p;
+}
+
+void params_bind(const ParamTable *t, const ExprProgram *prog, double *values) {
+    for (int i = 0; i < prog->n_params; i++) {
+        const Param *p = param_lookup(t, prog->params[i]);
+        values[i] = p ? p->value : NAN;
+    }
+}
+
+// all or nothing: count the names no earlier program or table entry has
+static bool params_declare(ParamTable *t, const ExprProgram *const *progs, int n) {
+    int fresh = 0;
+    for (int k = 0; k < n; k++) {
+        for (int i = 0; i < progs[k]->n_params; i++) {
+            const char *name = progs[k]->params[i];
+            bool seen = param_lookup(t, name) != NULL;
+            for (int j = 0; j < k && !seen; j++) seen = expr_param_index(progs[j], name) >= 0;
+            if (!seen) fresh++;
+        }
+    }
+    if (t->count + fresh > PLOTS_MAX_PARAMS) return false;
+
+    for (int k = 0; k < n; k++) {
+        for (int i = 0; i < progs[k]->n_params; i++) {
+            if (!param_lookup(t, progs[k]->params[i])) params_set(t, progs[k]->params[i], 1.0);
+        }
+    }
+    return true;
+}
+
+// next free slot, the old array is left in the arena until the next clear
+static PlotCmd *plot_slot(PlotRegistry *plots) {
+    if (plots->count == plots->cap) {
+        int cap = plots->cap ? plots->cap * 2 : 16;
+        PlotCmd *items = (PlotCmd*)arena_alloc(&plots->arena, (size_t)cap * sizeof(PlotCmd));
+        if (plots->count) memcpy(items, plots->items, (size_t)plots->count * sizeof(PlotCmd));
+        plots->items = items;
+        plots->cap = cap;
+    }
+    PlotCmd *cmd = &plots->items[plots->count];
+    memset(cmd, 0, sizeof(*cmd));
+    return cmd;
+}
+
+// compiled once into the arena, NULL on a syntax error
+static ExprProgram *compile_plot(PlotRegistry *plots, const char *expr, const char *var) {
+    ExprProgram *prog = (ExprProgram*)arena_alloc(&plots->arena, sizeof(ExprProgram));
+    return expr_compile_var(prog, expr, var) == 0 ? prog : NULL;
+}
+
+PlotCmd *plots_add_expr(PlotRegistry *plots, ParamTable *params, const char *expr, uint32_t color) {
+    ExprProgram *prog = compile_plot(plots, expr, "x");
+    const ExprProgram *progs[1] = { prog };
+    if (!prog || !params_declare(params, progs, 1)) return NULL;
+
+    PlotCmd *cmd = plot_slot(plots);
+    cmd->mode = PLOT_MODE_EXPR;
+    cmd->source = arena_strdup(&plots->arena, expr);
+    cmd->prog = prog;
+    cmd->color = color;
+    plots->count++;
+    return cmd;
+}
+
+PlotCmd *plots_add_curve(PlotRegistry *plots, ParamTable *params, const char *fx, const char *fy,
+                         double t0, double t1, uint32_t color) {
+    ExprProgram *prog = compile_plot(plots, fx, "t");
+    ExprProgram *prog_y = fy ? compile_plot(plots, fy, "t") : NULL;
+    const ExprProgram *progs[2] = { prog, prog_y };
+    if (!prog || (fy && !prog_y) || !params_declare(params, progs, fy ? 2 : 1)) return NULL;
+
+    PlotCmd *cmd = plot_slot(plots);
+    cmd->mode = fy ? PLOT_MODE_PARAM : PLOT_MODE_POLAR;
+    cmd->source = arena_strdup(&plots->arena, fx);
+    cmd->prog = prog;
+    cmd->prog_y = prog_y;
+    cmd->t0 = t0;
+    cmd->t1 = t1;
+    cmd->color = color;
+    plots->count++;
+    return cmd;
+}
+
+PlotCmd *plots_add_csv(PlotRegistry *plots, const char *path, int xcol, int ycol, int flags, uint32_t color) {
+    PlotCmd *cmd = plot_slot(plots);
+    if (series_update_csv(&cmd->series, &cmd->cursor, path, xcol, ycol, flags) != CSV_RELOADED
+        || cmd->series.len == 0) {
+        if (cmd->cursor.ino == 0) perror(path);
+        series_free(&cmd->series);
+        return NULL;
+    }
+    cmd->mode = PLOT_MODE_CSV;
+    cmd->source = arena_strdup(&plots->arena, path);
+    cmd->col_x = xcol;
+    cmd->col_y = ycol;
+    cmd->flags = flags;
+    cmd->color = color;
+    plots->count++;
+    return cmd;
+}
+
+PlotCmd *plots_add_overlay(PlotRegistry *plots, Overlay ov, uint32_t color) {
+    int target = -1;
+    for (int i = plots->count - 1; i >= 0 && target < 0; i--) {
+        if (plots->items[i].mode == PLOT_MODE_CSV) target = i;
+    }
+    if (target < 0) return NULL;
+
+    PlotCmd *cmd = plot_slot(plots);
+    cmd->mode = PLOT_MODE_OVERLAY;
+    cmd->source = "";
+    cmd->overlay = ov;
+    cmd->target = target;
+    cmd->color = color;
+    plots->count++;
+    return cmd;
+}
+
+int plots_update_csv(PlotRegistry *plots, int k) {
+    PlotCmd *cmd = &plots->items[k];
+    size_t kept = cmd->series.len - cmd->cursor.tail_rows; // samples an append leaves alone
+
+    int rc = series_update_csv(&cmd->series, &cmd->cursor, cmd->source, cmd->col_x, cmd->col_y, cmd->flags);
+    if (rc == CSV_ERROR || rc == CSV_UNCHANGED) return rc;
+    if (rc == CSV_RELOADED) kept = 0;
+
+    for (int i = 0; i < plots->count; i++) {
+        PlotCmd *ov = &plots->items[i];
+        if (ov->mode == PLOT_MODE_OVERLAY && ov->target == k && ov->overlay.fitted > kept) overlay_reset(&ov->overlay);
+    }
+    return rc;
+}
+
+void plots_remove_overlays(PlotRegistry *plots) {
+    int n = 0;
+    for (int i = 0; i < plots->count; i++) {
+        PlotCmd *cmd = &plots->items[i];
+        if (cmd->mode == PLOT_MODE_OVERLAY) overlay_free(&cmd->overlay);
+        else plots->items[n++] = *cmd;
+    }
+    plots->count = n;
+}
+
+bool plots_use_param(const PlotRegistry *plots, const char *name) {
+    for (int k = 0; k < plots->count; k++) {
+        const PlotCmd *cmd = &plots->items[k];
+        if ((cmd->prog && expr_param_index(cmd->prog, name) >= 0)
+            || (cmd->prog_y && expr_param_index(cmd->prog_y, name) >= 0)) return true;
+    }
+    return false;
+}
+
+void plots_clear(PlotRegistry *plots) {
+    for (int i = 0; i < plots->count; i++) {
+        series_free(&plots->items[i].series);
+        overlay_free(&plots->items[i].overlay);
+    }
+    plots->items = NULL;
+    plots->count = plots->cap = 0;
+    arena_reset(&plots->arena);
+}
+
+void plots_free(PlotRegistry *plots) {
+    plots_clear(plots);
+    arena_free(&plots->arena);
+}
+
+void plots_draw(PlotRegistry *plots, const ParamTable *params, Canvas *surf,
+                double xmin, double xmax, double ymin, double ymax) {
+    canvas_clear(surf);
+
+    for (int i = 0; i < plots->count; i++) {
+        PlotCmd *cmd = &plots->items[i];
+
+        if (cmd->mode == PLOT_MODE_EXPR) {
+            double values[EXPR_MAX_PARAMS];
+            params_bind(params, cmd->prog, values);
+            plot_program(surf, cmd->prog, values, cmd->color, xmin, xmax, ymin, ymax);
+        }
+        else if (cmd->mode == PLOT_MODE_CSV) {
+            plot_series(surf, &cmd->series, cmd->color, xmin, xmax, ymin, ymax);
+        }
+        else if (cmd->mode == PLOT_MODE_PARAM) {
+            double vx[EXPR_MAX_PARAMS], vy[EXPR_MAX_PARAMS];
+            params_bind(params, cmd->prog, vx);
+            params_bind(params, cmd->prog_y, vy);
+            plot_parametric(surf, cmd->prog, vx, cmd->prog_y, vy, cmd->t0, cmd->t1, cmd->color,
+                            xmin, xmax, ymin, ymax);
+        }
+        else if (cmd->mode == PLOT_MODE_POLAR) {
+            double values[EXPR_MAX_PARAMS];
+            params_bind(params, cmd->prog, values);
+            plot_polar(surf, cmd->prog, values, cmd->t0, cmd->t1, cmd->color, xmin, xmax, ymin, ymax);
+        }
+        else if (cmd->mode == PLOT_MODE_OVERLAY) {
+            plot_overlay(surf, &plots->items[cmd->target].series, &cmd->overlay, cmd->color,
+                         xmin, xmax, ymin, ymax);
+        }
+    }
+}
@@ -1,13 +1,33 @@
+#define _POSIX_C_SOURCE 200809L
 #include <termios.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
+#include <poll.h>
+#include <time.h>
+#include <stdarg.h>
 #include "../include/common.h"
 #include "../include/atedot.h"
+#include "../include/repl.h"
+#include "../include/stats.h"
+#include "../include/arena.h"
+#include "../include/watch.h"
+#include "../include/plots.h"
 
 #define MAX_CMD_HISTORY 100 // command line history
-#define MAX_PLOT_HISTORY 50 // active plots on screen
 #define MAX_LINE 256
 #define DEFAULT_COLOR 0x00FF00 // green
 #define DEFAULT_CSV_COLOR 0x00FFFF // cyan
+#define DEFAULT_MEAN_COLOR 0xFFFF00 // yellow
+#define DEFAULT_FIT_COLOR 0xFF00FF // magenta
+#define DEFAULT_BAND_COLOR 0xFF8800 // orange
+#define DEFAULT_CURVE_COLOR 0x4488FF // blue
+#define TWO_PI 6.283185307179586
+#define MAX_PANES 16
+#define WATCH_QUIET_MS 50       // redraw once the watched files were quiet this long
+#define WATCH_MAX_DELAY_MS 250  // or this long after the first change, for steady writers
+#define WATCH_HEADROOM 0.25     // of the samples' range, added when an autoscaled view grows
 
 // state for zoom/pan
 typedef struct {
@@ -15,28 +35,59 @@ typedef struct {
     bool locked; // true if user manually set view
 } ViewState;
 
-typedef enum {
-    PLOT_MODE_EXPR,
-    PLOT_MODE_CSV
-} PlotMode;
-
+// one viewport of the layout, with its own canvas, view and plots
 typedef struct {
-    PlotMode mode;
-    char source[MAX_LINE];
-    uint32_t color;
-    int col_x, col_y;
-} PlotCmd;
-
-static ViewState view = { -10, 10, -5, 5, false };
+    Canvas *surf;           // the caller's canvas for pane 1, `own` for the rest
+    Canvas own;
+    ViewState view;
+    PlotRegistry plots;
+    bool time_axis;         // x labels as dates/times, x is epoch seconds
+    bool dirty;             // replot before the next frame
+    FrameStats stats;       // from the worker thread that replotted it
+    pthread_t worker;       // replots the pane when queued, panes past the first
+    bool has_worker;
+    bool queued, quit;      // guarded by pool_lock
+} Pane;
+
+static const ViewState default_view = { -10, 10, -5, 5, false };
 
 static struct termios orig_termios;
 
-static PlotCmd plot_history[MAX_PLOT_HISTORY];
-static int plot_count = 0;
+// row-major grid of panes, commands act on the focused one
+static Pane panes[MAX_PANES] = { { .view = { -10, 10, -5, 5, false } } };
+static int layout_rows = 1, layout_cols = 1;
+static Pane *pane = &panes[0];
 
 static int global_x_ticks = 5;
 static int global_y_ticks = 5;
 
+static int csv_flags = 0;       // SERIES_X_* for new csv plots
+
+static ParamTable params;       // shared by every pane
+
+// csv files of every pane, watched in interactive sessions after `watch on`
+static Watcher watcher = { .fd = -1 };
+static bool watching = false;
+static double watch_first = 0, watch_last = 0; // unhandled changes, 0 if none
+
+// frames are composed in memory and leave in a single write()
+static FILE *frame_buf = NULL;
+static char *frame_data = NULL;
+static size_t frame_size = 0;
+
+// where frames and messages go, interactive by default
+typedef struct {
+    const char *script;     // script path, NULL when interactive
+    int line_no;            // current script line
+    const char *out_dir;    // frame directory, NULL for stdout
+    const char *stem;       // frame file prefix
+    int frame_no;
+    bool use_color;
+    int errors;             // failed commands and frame writes, the script's exit status
+} ReplOutput;
+
+static ReplOutput output = { NULL, 0, NULL, NULL, 0, true, 0 };
+
 static void disable_raw_mode(void) {
     tcsetattr(STDIN_FILENO, TCSAFLUSH, &orig_termios);
 }
@@ -63,43 +114,426 @@ static bool parse_hex(const char *str, uint32_t *out) {
     return false;
 }
 
-// wipes canvas and redraws everything in history
-static void replot_all(Canvas *surf) {
-    canvas_clear(surf);
+// wipes the pane's canvas and redraws everything in its history
+static void replot_all(Pane *p) {
+    const ViewState *view = &p->view;
+    plots_draw(&p->plots, &params, p->surf, view->xmin, view->xmax, view->ymin, view->ymax);
+}
+
+// panes past the first each have a parked worker thread, started by set_layout
+// and joined when the grid shrinks, so a frame never creates threads
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_wake = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t pool_done = PTHREAD_COND_INITIALIZER;
+static int pool_pending = 0;    // queued panes not replotted yet
+
+static void *pane_worker(void *arg) {
+    Pane *p = arg;
+    stats_tid = 2 + (int)(p - panes);
+
+    pthread_mutex_lock(&pool_lock);
+    for (;;) {
+        while (!p->queued && !p->quit) pthread_cond_wait(&pool_wake, &pool_lock);
+        if (p->quit) break;
+        pthread_mutex_unlock(&pool_lock);
+
+        memset(&stats_current, 0, sizeof(stats_current));
+        uint64_t allocs = atedot_alloc_count;
+        replot_all(p);
+        p->stats = stats_current;
+        p->stats.counters[COUNTER_ALLOCS] = atedot_alloc_count - allocs;
+
+        pthread_mutex_lock(&pool_lock);
+        p->queued = false;
+        if (--pool_pending == 0) pthread_cond_signal(&pool_done);
+    }
+    pthread_mutex_unlock(&pool_lock);
+    return NULL;
+}
+
+static void worker_start(Pane *p) {
+    p->has_worker = pthread_create(&p->worker, NULL, pane_worker, p) == 0;
+}
+
+static void worker_stop(Pane *p) {
+    if (!p->has_worker) return;
+    pthread_mutex_lock(&pool_lock);
+    p->quit = true;
+    pthread_cond_broadcast(&pool_wake);
+    pthread_mutex_unlock(&pool_lock);
+    pthread_join(p->worker, NULL);
+    p->has_worker = false;
+}
+
+// replot the dirty panes, the first on this thread and the rest on their workers
+// panes share nothing but read-only plot sources, clean panes keep their raster
+static void replot_dirty(void) {
+    STATS_BEGIN(t0);
+    int n = layout_rows * layout_cols;
+    Pane *first = NULL;
+    bool queued = false;
+
+    pthread_mutex_lock(&pool_lock);
+    for (int i = 0; i < n; i++) {
+        if (!panes[i].dirty) continue;
+        if (!first) { first = &panes[i]; continue; }
+        if (!panes[i].has_worker) continue; // thread creation failed, replotted here below
+
+        panes[i].queued = true;
+        pool_pending++;
+        queued = true;
+    }
+    if (queued) pthread_cond_broadcast(&pool_wake);
+    pthread_mutex_unlock(&pool_lock);
+    if (!first) return;
+
+    for (int i = 0; i < n; i++) {
+        if (panes[i].dirty && (&panes[i] == first || !panes[i].has_worker)) replot_all(&panes[i]);
+    }
+
+    if (queued) {
+        pthread_mutex_lock(&pool_lock);
+        while (pool_pending > 0) pthread_cond_wait(&pool_done, &pool_lock);
+        pthread_mutex_unlock(&pool_lock);
+    }
+    for (int i = 0; i < n; i++) {
+        if (panes[i].dirty && panes[i].has_worker && &panes[i] != first) stats_merge(&panes[i].stats);
+        panes[i].dirty = false;
+    }
+    STATS_END(STAGE_REPLOT, t0);
+}
+
+// an unlocked view takes the extent of the latest csv samples
+static void follow_series(Pane *p, const Series *s) {
+    if (!p->view.locked) {
+        p->view.xmin = s->xmin; p->view.xmax = s->xmax;
+        p->view.ymin = s->ymin; p->view.ymax = s->ymax;
+    }
+    if (s->x_time) p->time_axis = true;
+}
+
+// panes past the first own a canvas the size of the first one
+static void pane_init(Pane *p, int px_w, int px_h) {
+    memset(p, 0, sizeof(*p));
+    p->own = canvas_make(px_w, px_h);
+    p->surf = &p->own;
+    p->view = default_view;
+    worker_start(p);
+}
+
+static void pane_free(Pane *p) {
+    worker_stop(p);
+    plots_free(&p->plots);
+    canvas_free(&p->own);
+    memset(p, 0, sizeof(*p));
+}
+
+// grow or shrink the grid, surviving panes keep their plots and raster
+static void set_layout(int rows, int cols) {
+    int old_n = layout_rows * layout_cols, n = rows * cols;
+    for (int i = n; i < old_n; i++) pane_free(&panes[i]);
+    for (int i = old_n; i < n; i++) pane_init(&panes[i], panes[0].surf->px_w, panes[0].surf->px_h);
+
+    layout_rows = rows;
+    layout_cols = cols;
+    if (pane - panes >= n) pane = &panes[0];
+}
+
+// status message, silent in script mode
+static void say(const char *fmt, ...) {
+    if (output.script) return;
+    va_list ap;
+    va_start(ap, fmt);
+    vprintf(fmt, ap);
+    va_end(ap);
+}
+
+// error or usage message, goes to stderr with location in script mode
+static void complain(const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    if (output.script) {
+        output.errors++;
+        fprintf(stderr, "%s:%d: ", output.script, output.line_no);
+        vfprintf(stderr, fmt, ap);
+    } else vprintf(fmt, ap);
+    va_end(ap);
+}
+
+static void render_frame_to(FILE *out) {
+    RenderPane rp[MAX_PANES];
+    int n = layout_rows * layout_cols;
+    for (int i = 0; i < n; i++) {
+        const Pane *p = &panes[i];
+        rp[i] = (RenderPane){ p->surf, p->view.xmin, p->view.xmax, p->view.ymin, p->view.ymax, p->time_axis };
+    }
+    render_grid_to(out, rp, layout_rows, layout_cols, global_x_ticks, global_y_ticks, output.use_color);
+}
+
+static bool write_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+// replot what changed and render into the frame buffer, returns its length
+// the stream is rewound, not freed, so steady-state frames don't allocate
+static size_t compose_frame(const char *prefix) {
+    replot_dirty();
 
-    for (int i = 0; i < plot_count; i++) {
-        PlotCmd *cmd = &plot_history[i];
+    if (!frame_buf && !(frame_buf = open_memstream(&frame_data, &frame_size))) {
+        perror("open_memstream");
+        return 0;
+    }
+    rewind(frame_buf);
+    fputs(prefix, frame_buf);
+    render_frame_to(frame_buf);
+    fflush(frame_buf);
+    return (size_t)ftell(frame_buf);
+}
 
-        if (cmd->mode == PLOT_MODE_EXPR) {
-            plot_expr(surf, cmd->source, cmd->color,
-                      view.xmin, view.xmax, view.ymin, view.ymax);
+// print the frame, or write it to the next frame file in script mode
+static void show_frame(void) {
+    size_t len = compose_frame(output.out_dir ? "" : "\n");
+    if (len == 0) return;
+
+    int frame = output.frame_no++;
+    if (!output.out_dir) {
+        fflush(stdout); // earlier messages go first
+        if (!write_all(STDOUT_FILENO, frame_data, len)) {
+            perror("write");
+            if (output.script) output.errors++;
         }
-        else if (cmd->mode == PLOT_MODE_CSV) {
-            double d1, d2, d3, d4;
-            plot_from_csv(surf, cmd->source, cmd->col_x, cmd->col_y, cmd->color,
-                          &d1, &d2, &d3, &d4);
+        stats_frame_end();
+        return;
+    }
+
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/%s-%04d.txt", output.out_dir, output.stem, frame);
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        perror(path);
+        output.errors++;
+        return;
+    }
+    if (!write_all(fd, frame_data, len)) {
+        perror(path);
+        output.errors++;
+    }
+    close(fd);
+    stats_frame_end();
+}
+
+static void frame_buf_close(void) {
+    if (frame_buf) fclose(frame_buf);
+    free(frame_data);
+    frame_buf = NULL;
+    frame_data = NULL;
+    frame_size = 0;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// nearest-rank percentile of sorted samples
+static double percentile(const double *sorted, int n, double q) {
+    int k = (int)ceil(q / 100.0 * n) - 1;
+    return sorted[k < 0 ? 0 : k];
+}
+
+static void sleep_until(double t) {
+    struct timespec ts;
+    ts.tv_sec = (time_t)t;
+    ts.tv_nsec = (long)((t - (double)ts.tv_sec) * 1e9);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {}
+}
+
+// any key stops an interactive animation
+static bool key_pressed(void) {
+    struct pollfd pfd = { STDIN_FILENO, POLLIN, 0 };
+    if (poll(&pfd, 1, 0) <= 0) return false;
+    char c;
+    return read(STDIN_FILENO, &c, 1) == 1;
+}
+
+// panes with an expression over `name` are the only ones a sweep redraws
+static void mark_param_users(const char *name) {
+    for (int i = 0; i < layout_rows * layout_cols; i++) {
+        if (plots_use_param(&panes[i].plots, name)) panes[i].dirty = true;
+    }
+}
+
+// sweep a parameter over `frames` frames at `fps`
+// interactive runs draw in the alternate screen on a fixed schedule and skip
+// frames whose slot has already passed, scripts write every frame unpaced
+static void animate(Param *param, double from, double to, int frames, double fps) {
+    bool paced = !output.script;
+    double *frame_ms = MALLOC(double, frames);
+    int shown = 0, dropped = 0;
+    uint64_t allocs = atedot_alloc_count;
+
+    if (paced) {
+        fputs("\x1b[?1049h\x1b[?25l\x1b[2J", stdout); // alternate screen, hide cursor
+        fflush(stdout);
+    }
+
+    double period = 1.0 / fps;
+    double start = stats_now();
+    for (int i = 0; i < frames; i++) {
+        double due = start + i * period;
+        if (paced) {
+            // late by a whole slot: drop it, but always show the last value
+            if (i + 1 < frames && stats_now() > due + period) { dropped++; continue; }
+            sleep_until(due);
+            if (key_pressed()) break;
+        }
+
+        double t0 = stats_now();
+        param->value = frames > 1 ? from + (to - from) * i / (frames - 1) : to;
+        mark_param_users(param->name);
+
+        if (paced) {
+            size_t len = compose_frame("\x1b[H");
+            if (len == 0 || !write_all(STDOUT_FILENO, frame_data, len)) break;
+            stats_frame_end();
+        } else show_frame();
+
+        frame_ms[shown++] = (stats_now() - t0) * 1e3;
+    }
+    double elapsed = stats_now() - start;
+    allocs = atedot_alloc_count - allocs;
+
+    if (paced) {
+        fputs("\x1b[?25h\x1b[?1049l", stdout);
+        show_frame(); // leave the final state on the main screen
+    }
+
+    if (shown > 0) {
+        qsort(frame_ms, (size_t)shown, sizeof(double), cmp_double);
+        FILE *out = output.script ? stderr : stdout;
+        fprintf(out, "\nanimate %s: %d frames in %.2f s, %.1f fps", param->name, shown, elapsed, shown / elapsed);
+        if (paced) fprintf(out, " (target %.1f), %d dropped\n", fps, dropped);
+        else fputs(" (unpaced)\n", out);
+        fprintf(out, "frame time p50 %.3f ms  p90 %.3f ms  p99 %.3f ms  max %.3f ms, %llu allocations\n",
+                percentile(frame_ms, shown, 50), percentile(frame_ms, shown, 90),
+                percentile(frame_ms, shown, 99), frame_ms[shown - 1], (unsigned long long)allocs);
+    }
+    free(frame_ms);
+}
+
+// watch every csv plotted in any pane, returns how many there are
+static int watch_sync(void) {
+    int n = 0;
+    watch_reset(&watcher);
+    for (int i = 0; i < layout_rows * layout_cols; i++) {
+        const PlotRegistry *plots = &panes[i].plots;
+        for (int k = 0; k < plots->count; k++) {
+            if (plots->items[k].mode != PLOT_MODE_CSV) continue;
+            if (watch_add(&watcher, plots->items[k].source) == 0) n++;
         }
     }
+    return n;
+}
+
+// an autoscaled view the samples outgrew widens past them on the sides they crossed,
+// so steady appends replot a logarithmic number of times instead of once per row
+static void grow_view(Pane *p, const Series *s) {
+    ViewState *v = &p->view;
+    double dx = (s->xmax - s->xmin) * WATCH_HEADROOM, dy = (s->ymax - s->ymin) * WATCH_HEADROOM;
+    if (s->xmin < v->xmin) v->xmin = s->xmin - dx;
+    if (s->xmax > v->xmax) v->xmax = s->xmax + dx;
+    if (s->ymin < v->ymin) v->ymin = s->ymin - dy;
+    if (s->ymax > v->ymax) v->ymax = s->ymax + dy;
+    if (s->x_time) p->time_axis = true;
+}
+
+// read what was appended to one csv plot, true if its samples changed
+// new samples are drawn straight onto the pane when they are all a replot would
+// add: the view still holds them, no rows were re-parsed, nothing is fitted to them
+// plots drawn after the csv stay as they are, the new points land on top
+static bool update_csv_plot(Pane *p, int k) {
+    PlotCmd *cmd = &p->plots.items[k];
+    const Series *s = &cmd->series;
+    size_t old_len = s->len;
+    bool redrawn = cmd->cursor.tail_rows > 0;
+
+    int rc = plots_update_csv(&p->plots, k);
+    if (rc == CSV_ERROR || rc == CSV_UNCHANGED) return false; // a rotated file may be back soon
+    if (rc == CSV_RELOADED) {
+        follow_series(p, s);
+        p->dirty = true;
+        return true;
+    }
+
+    const ViewState *v = &p->view;
+    if (!v->locked && (s->xmin < v->xmin || s->xmax > v->xmax || s->ymin < v->ymin || s->ymax > v->ymax)) {
+        grow_view(p, s);
+        p->dirty = true;
+    }
+    for (int i = 0; i < p->plots.count && !p->dirty; i++) {
+        const PlotCmd *ov = &p->plots.items[i];
+        if (ov->mode == PLOT_MODE_OVERLAY && ov->target == k) p->dirty = true;
+    }
+    if (redrawn) p->dirty = true;
+
+    if (!p->dirty) plot_series_from(p->surf, s, old_len, cmd->color, v->xmin, v->xmax, v->ymin, v->ymax);
+    return true;
 }
 
-static void add_plot_expr(const char *expr, uint32_t color) {
-    if (plot_count >= MAX_PLOT_HISTORY) return;
-    plot_history[plot_count].mode = PLOT_MODE_EXPR;
-    strncpy(plot_history[plot_count].source, expr, MAX_LINE-1);
-    plot_history[plot_count].color = color;
-    plot_count++;
+// bring every watched csv up to date, redraw if one of them changed
+static bool refresh_watched(void) {
+    bool changed = false;
+    for (int i = 0; i < layout_rows * layout_cols; i++) {
+        for (int k = 0; k < panes[i].plots.count; k++) {
+            if (panes[i].plots.items[k].mode == PLOT_MODE_CSV) changed |= update_csv_plot(&panes[i], k);
+        }
+    }
+    if (!changed) return false;
+
+    fputs("\r\033[K", stdout); // the frame replaces the prompt line
+    show_frame();
+    return true;
 }
 
-static void add_plot_csv(const char *filename, int cx, int cy, uint32_t color) {
-    if (plot_count >= MAX_PLOT_HISTORY) return;
-    plot_history[plot_count].mode = PLOT_MODE_CSV;
-    strncpy(plot_history[plot_count].source, filename, MAX_LINE-1);
-    plot_history[plot_count].col_x = cx;
-    plot_history[plot_count].col_y = cy;
-    plot_history[plot_count].color = color;
-    plot_count++;
+// bursts of writes are coalesced: the redraw waits for a quiet gap, bounded so
+// a steady writer still sees updates
+static double watch_due(void) {
+    return fmin(watch_last + WATCH_QUIET_MS * 1e-3, watch_first + WATCH_MAX_DELAY_MS * 1e-3);
 }
 
+// block until a key is ready, false if watched files redrew the frame meanwhile
+static bool wait_for_key(void) {
+    while (watching) {
+        int timeout = -1;
+        if (watch_first > 0) {
+            double left = watch_due() - stats_now();
+            timeout = left > 0 ? (int)ceil(left * 1e3) : 0;
+        }
+
+        struct pollfd pfd[2] = { { STDIN_FILENO, POLLIN, 0 }, { watcher.fd, POLLIN, 0 } };
+        int n = poll(pfd, 2, timeout);
+        if (n < 0 && errno != EINTR) return true;
+
+        if (n > 0 && (pfd[1].revents & POLLIN) && watch_drain(&watcher)) {
+            watch_last = stats_now();
+            if (watch_first == 0) watch_first = watch_last;
+        }
+        if (n > 0 && pfd[0].revents) return true;
+
+        if (watch_first > 0 && stats_now() >= watch_due()) {
+            watch_first = watch_last = 0;
+            if (refresh_watched()) return false;
+        }
+    }
+    return true;
+}
 
 // read one line with editing & history
 static int readline(char *out, size_t out_size, char **history, int *history_len, int *history_index) {
@@ -108,13 +542,13 @@ static int readline(char *out, size_t out_size, char **history, int *history_len
 
     while (1) {
         char c;
-        if (read(STDIN_FILENO, &c, 1) <= 0) continue;
+        if (!wait_for_key()) c = '\0'; // frame redrawn, only the line is repainted
+        else if (read(STDIN_FILENO, &c, 1) <= 0) continue;
 
         if (c == '\n') {
             buf[len] = '\0';
             printf("\n");
-            strncpy(out, buf, out_size);
-            out[out_size-1] = '\0';
+            snprintf(out, out_size, "%s", buf);
             if (len > 0 && *history_len < MAX_CMD_HISTORY) {
                 history[*history_len] = strdup(buf);
                 (*history_len)++;
@@ -140,7 +574,7 @@ static int readline(char *out, size_t out_size, char **history, int *history_len
                         memset(buf, 0, MAX_LINE);
 
                         if (history[*history_index]) {
-                            strncpy(buf, history[*history_index], MAX_LINE);
+                            snprintf(buf, MAX_LINE, "%s", history[*history_index]);
                             len = strlen(buf);
                             cursor = len;
                         }
@@ -151,7 +585,7 @@ static int readline(char *out, size_t out_size, char **history, int *history_len
                         memset(buf, 0, MAX_LINE);
 
                         if (*history_index < *history_len && history[*history_index]) {
-                            strncpy(buf, history[*history_index], MAX_LINE);
+                            snprintf(buf, MAX_LINE, "%s", history[*history_index]);
                             len = strlen(buf);
                             cursor = len;
                         }
@@ -183,170 +617,406 @@ static int readline(char *out, size_t out_size, char **history, int *history_len
     }
 }
 
-void repl(Canvas *surf) {
-    char line[MAX_LINE];
-    char *cmd_history[MAX_CMD_HISTORY] = {0};
-    int cmd_hist_len = 0, cmd_hist_idx = 0;
+// split at blanks outside parentheses, so "sin(2 * t)" stays one argument
+static int split_args(char *s, char **argv, int max) {
+    int argc = 0, depth = 0;
+    while (*s) {
+        while (*s == ' ' || *s == '\t') *s++ = '\0';
+        if (!*s) break;
+        if (argc == max) return -1;
+        argv[argc++] = s;
+        for (; *s && (depth > 0 || (*s != ' ' && *s != '\t')); s++) {
+            if (*s == '(') depth++;
+            else if (*s == ')' && depth > 0) depth--;
+        }
+    }
+    return argc;
+}
 
-    enable_raw_mode();
+// constant argument such as a t range, false if it isn't one
+static bool parse_const(const char *arg, double *out) {
+    int err;
+    *out = expr_eval(arg, 0, &err);
+    return !err && isfinite(*out);
+}
 
-    printf(" > ");
-    fflush(stdout);
+// plot param <fx(t)> <fy(t)> <t0> <t1> [hex]  /  plot polar <r(t)> [<t0> <t1>] [hex]
+// false if the arguments don't form a curve, the line may still be an expression
+// over parameters named param or polar
+static bool exec_plot_curve(char *args, bool polar) {
+    char *argv[6];
+    int argc = split_args(args, argv, 6);
+    uint32_t color = DEFAULT_CURVE_COLOR;
+    if (argc > 0 && (strncmp(argv[argc - 1], "0x", 2) == 0 || strncmp(argv[argc - 1], "0X", 2) == 0)
+        && parse_hex(argv[argc - 1], &color)) argc--;
+
+    double t0 = 0, t1 = TWO_PI;
+    bool ok = polar ? argc == 1 || argc == 3 : argc == 4;
+    int range = polar ? 1 : 2;
+    if (ok && argc > range) ok = parse_const(argv[range], &t0) && parse_const(argv[range + 1], &t1) && t1 > t0;
+    if (!ok || !plots_add_curve(&pane->plots, &params, argv[0], polar ? NULL : argv[1], t0, t1, color)) return false;
+
+    pane->dirty = true;
+    show_frame();
+    say("\n");
+    return true;
+}
 
-    while (readline(line, sizeof(line), cmd_history, &cmd_hist_len, &cmd_hist_idx) > 0) {
-        if (strcmp(line, "exit") == 0 || strcmp(line, "quit") == 0) break;
+// run a single command line against the focused pane, false on exit/quit
+static bool exec_command(const char *line) {
+    ViewState *view = &pane->view;
+    PlotRegistry *plots = &pane->plots;
 
-        if (strcmp(line, "clear") == 0 || strcmp(line, "clean") == 0) {
-            plot_count = 0; // reset history
-            canvas_clear(surf);
-            printf("Canvas cleared.\n");
-        }
+    if (strcmp(line, "exit") == 0 || strcmp(line, "quit") == 0) return false;
 
-        else if (strncmp(line, "reset", 5) == 0) {
-            view.xmin = -10.0; view.xmax = 10.0;
-            view.ymin = -5.0;  view.ymax = 5.0;
-            view.locked = false;
+    if (strcmp(line, "clear") == 0 || strcmp(line, "clean") == 0) {
+        plots_clear(plots); // reset history
+        canvas_clear(pane->surf);
+        say("Canvas cleared.\n");
+    }
 
-            replot_all(surf);
-            printf("\n");
-            render_full_w_axes(surf, view.xmin, view.xmax, view.ymin, view.ymax, global_x_ticks, global_y_ticks, true);
-            printf("\nViewport reset.\n");
-        }
+    else if (strncmp(line, "reset", 5) == 0) {
+        *view = default_view;
 
-        else if (strncmp(line, "zoom ", 5) == 0) {
-            double fx, fy;
-            int args = sscanf(line + 5, "%lf %lf", &fx, &fy);
-
-            if (args == 1) fy = fx;
-            if (args >= 1 && fx > 0 && fy > 0) {
-                double cx = (view.xmin + view.xmax) / 2.0;
-                double cy = (view.ymin + view.ymax) / 2.0;
-                double rx = (view.xmax - view.xmin) / 2.0 / fx;
-                double ry = (view.ymax - view.ymin) / 2.0 / fy;
-                view.xmin = cx - rx; view.xmax = cx + rx;
-                view.ymin = cy - ry; view.ymax = cy + ry;
-                view.locked = true;
-
-                replot_all(surf);
-
-                printf("\n");
-                render_full_w_axes(surf, view.xmin, view.xmax, view.ymin, view.ymax, global_x_ticks, global_y_ticks, true);
-
-                if (args == 1) {
-                    printf("\nZoomed x%.2f (Uniform)\n", fx);
-                } else {
-                    printf("\nZoomed X: x%.2f, Y: x%.2f\n", fx, fy);
-                }
+        pane->dirty = true;
+        show_frame();
+        say("\nViewport reset.\n");
+    }
+
+    else if (strncmp(line, "zoom ", 5) == 0) {
+        double fx, fy;
+        int args = sscanf(line + 5, "%lf %lf", &fx, &fy);
+
+        if (args == 1) fy = fx;
+        if (args >= 1 && fx > 0 && fy > 0) {
+            double cx = (view->xmin + view->xmax) / 2.0;
+            double cy = (view->ymin + view->ymax) / 2.0;
+            double rx = (view->xmax - view->xmin) / 2.0 / fx;
+            double ry = (view->ymax - view->ymin) / 2.0 / fy;
+            view->xmin = cx - rx; view->xmax = cx + rx;
+            view->ymin = cy - ry; view->ymax = cy + ry;
+            view->locked = true;
+
+            pane->dirty = true;
+            show_frame();
+
+            if (args == 1) {
+                say("\nZoomed x%.2f (Uniform)\n", fx);
             } else {
-                printf("Usage: zoom <factor>  OR  zoom <x_factor> <y_factor>\n");
+                say("\nZoomed X: x%.2f, Y: x%.2f\n", fx, fy);
             }
+        } else {
+            complain("Usage: zoom <factor>  OR  zoom <x_factor> <y_factor>\n");
         }
+    }
+
+    else if (strncmp(line, "size ", 5) == 0) {
+        int w, h;
+        if (sscanf(line + 5, "%d %d", &w, &h) == 2) {
+            // every pane gets the same size so rows of the grid line up
+            for (int i = 0; i < layout_rows * layout_cols; i++) {
+                canvas_resize(panes[i].surf, w, h);
+                panes[i].dirty = true;
+            }
+            show_frame();
+            say("\nResized to %dx%d\n", w, h);
+        } else complain("Usage: size <width> <height>\n");
+    }
 
-        else if (strncmp(line, "size ", 5) == 0) {
-            int w, h;
-            if (sscanf(line + 5, "%d %d", &w, &h) == 2) {
-                canvas_resize(surf, w, h);
+    else if (strncmp(line, "ticks", 5) == 0) {
+        int xt, yt;
+        if (sscanf(line + 5, "%d %d", &xt, &yt) == 2) {
+            if (xt > 1) global_x_ticks = xt;
+            if (yt > 1) global_y_ticks = yt;
 
-                replot_all(surf);
-                printf("\n");
-                render_full_w_axes(surf, view.xmin, view.xmax, view.ymin, view.ymax, global_x_ticks, global_y_ticks, true);
-                printf("\nResized to %dx%d\n", w, h);
-            } else printf("Usage: size <width> <height>\n");
-        }
+            show_frame();
+            say("\nTicks set: x=%d, y=%d\n", global_x_ticks, global_y_ticks);
+        } else complain("Usage: ticks <x_ticks> <y_ticks>\n");
+    }
+
+    else if (strncmp(line, "xaxis", 5) == 0) {
+        const char *arg = line + 5;
+        while (*arg == ' ') arg++;
 
-        else if (strncmp(line, "ticks", 5) == 0) {
-            int xt, yt;
-            if (sscanf(line + 5, "%d %d", &xt, &yt) == 2) {
-                if (xt > 1) global_x_ticks = xt;
-                if (yt > 1) global_y_ticks = yt;
+        bool ok = true;
+        if (strcmp(arg, "num") == 0) { pane->time_axis = false; csv_flags &= ~SERIES_X_EPOCH_MS; }
+        else if (strcmp(arg, "time") == 0) pane->time_axis = true;
+        else if (strcmp(arg, "ms") == 0) { pane->time_axis = true; csv_flags |= SERIES_X_EPOCH_MS; }
+        else ok = false;
 
-                printf("\n");
-                render_full_w_axes(surf, view.xmin, view.xmax, view.ymin, view.ymax, global_x_ticks, global_y_ticks, true);
-                printf("\nTicks set: x=%d, y=%d\n", global_x_ticks, global_y_ticks);
-            } else printf("Usage: ticks <x_ticks> <y_ticks>\n");
+        if (ok) {
+            show_frame();
+            say("\nX axis: %s\n", arg);
+        } else complain("Usage: xaxis num | time | ms   (ms: x column is epoch millis)\n");
+    }
+
+    else if (strncmp(line, "overlay", 7) == 0) {
+        const char *arg = line + 7;
+        while (*arg == ' ') arg++;
+
+        Overlay ov;
+        memset(&ov, 0, sizeof(ov));
+        uint32_t color = 0;
+        unsigned int hex_in;
+        bool ok = false;
+        int args;
+
+        if (strcmp(arg, "clear") == 0) {
+            plots_remove_overlays(plots);
+            pane->dirty = true;
+            show_frame();
+            say("\nOverlays cleared.\n");
+        } else {
+            if ((args = sscanf(arg, "mean %d %x", &ov.window, &hex_in)) >= 1 && ov.window > 0) {
+                ov.kind = OVERLAY_MEAN;
+                color = args == 2 ? hex_in : DEFAULT_MEAN_COLOR;
+                ok = true;
+            } else if (strncmp(arg, "fit linear", 10) == 0) {
+                ov.kind = OVERLAY_FIT_LINEAR;
+                color = sscanf(arg + 10, " %x", &hex_in) == 1 ? hex_in : DEFAULT_FIT_COLOR;
+                ok = true;
+            } else if ((args = sscanf(arg, "band %lf %lf %x", &ov.q_lo, &ov.q_hi, &hex_in)) >= 2
+                       && ov.q_lo >= 0 && ov.q_lo < ov.q_hi && ov.q_hi <= 100) {
+                ov.kind = OVERLAY_BAND;
+                color = args == 3 ? hex_in : DEFAULT_BAND_COLOR;
+                ok = true;
+            }
+
+            if (!ok) complain("Usage: overlay mean <window> | fit linear | band <lo> <hi> [hex_color]  OR  overlay clear\n");
+            else if (!plots_add_overlay(plots, ov, color)) complain("Error: Overlays need a csv plot first.\n");
+            else {
+                pane->dirty = true;
+                show_frame();
+                say("\n");
+            }
         }
+    }
+
+    else if (strncmp(line, "param", 5) == 0) {
+        char name[EXPR_MAX_NAME];
+        double value;
+        if (sscanf(line + 5, " %15[A-Za-z0-9_] %lf", name, &value) == 2 && isalpha((unsigned char)name[0])
+            && strcmp(name, "x") != 0) {
+            if (params_set(&params, name, value)) {
+                mark_param_users(name);
+                show_frame();
+                say("\n%s = %g\n", name, value);
+            } else complain("Error: At most %d parameters.\n", PLOTS_MAX_PARAMS);
+        } else if (line[5] == '\0') {
+            for (int i = 0; i < params.count; i++) say("%s = %g\n", params.items[i].name, params.items[i].value);
+        } else complain("Usage: param <name> <value>\n");
+    }
+
+    else if (strncmp(line, "animate", 7) == 0) {
+        char name[EXPR_MAX_NAME];
+        double from, to, fps = 30;
+        int frames;
+        int args = sscanf(line + 7, " %15[A-Za-z0-9_] %lf %lf %d %lf", name, &from, &to, &frames, &fps);
+
+        Param *p = args >= 4 ? params_find(&params, name) : NULL;
+        if (args < 4 || frames < 1 || !(fps > 0)) complain("Usage: animate <param> <from> <to> <frames> [fps]   e.g. animate a 1 10 120 30fps\n");
+        else if (!p) complain("Error: No plot uses '%s'.\n", name);
+        else animate(p, from, to, frames, fps);
+    }
 
-        else if (strncmp(line, "plot", 4) == 0) {
-            char *p = line + 4;
-            while (*p == ' ' || *p == '\t') p++;
+    else if (strncmp(line, "layout", 6) == 0) {
+        int rows, cols;
+        if (sscanf(line + 6, " %dx%d", &rows, &cols) == 2 && rows >= 1 && cols >= 1 && rows * cols <= MAX_PANES) {
+            set_layout(rows, cols);
+            show_frame();
+            say("\nLayout %dx%d, pane %d focused.\n", rows, cols, (int)(pane - panes) + 1);
+        } else complain("Usage: layout <rows>x<cols>   (at most %d panes)\n", MAX_PANES);
+    }
+
+    else if (strncmp(line, "pane", 4) == 0) {
+        int n = layout_rows * layout_cols, k;
+        if (sscanf(line + 4, "%d", &k) == 1 && k >= 1 && k <= n) {
+            pane = &panes[k - 1];
+            say("Pane %d focused.\n", k);
+        } else complain("Usage: pane <1-%d>   (row-major)\n", n);
+    }
 
-            // "plot" -> view current state
-            if (*p == '\0' || *p == '\n') {
-                printf("\n");
-                render_full_w_axes(surf, view.xmin, view.xmax, view.ymin, view.ymax, global_x_ticks, global_y_ticks, true);
-                printf("\n");
+    else if (strncmp(line, "watch", 5) == 0) {
+        const char *arg = line + 5;
+        while (*arg == ' ') arg++;
+
+        if (strcmp(arg, "on") == 0) {
+            if (output.script) complain("Error: watch needs an interactive session.\n");
+            else if (!watching && watch_open(&watcher) != 0) complain("Error: Can't watch files here.\n");
+            else {
+                watching = true;
+                int n = watch_sync();
+                bool drawn = refresh_watched(); // catch up on changes since they were plotted
+                say("%sWatching %d csv file%s.\n", drawn ? "\n" : "", n, n == 1 ? "" : "s");
             }
-            // "plot ..." -> new plot
+        } else if (strcmp(arg, "off") == 0) {
+            watch_close(&watcher);
+            watching = false;
+            watch_first = watch_last = 0;
+            say("Watch off.\n");
+        } else if (*arg == '\0') {
+            say("Watch is %s.\n", watching ? "on" : "off");
+        } else complain("Usage: watch [on|off]\n");
+    }
+
+    else if (strncmp(line, "stats", 5) == 0) {
+        const char *arg = line + 5;
+        while (*arg == ' ') arg++;
+
+        if (strcmp(arg, "on") == 0) {
+            stats_enabled = true;
+            say("Stats on.\n");
+        } else if (strcmp(arg, "off") == 0) {
+            if (stats_trace_path()) complain("Error: Stats are needed while tracing.\n");
             else {
-                if (*p == '"' || *p == '\'') {
-                    char quote = *p++;
-                    char *end = strchr(p, quote);
-                    if (end) {
-                        char filename[128];
-                        size_t len = end - p;
-                        if (len >= sizeof(filename)) len = sizeof(filename)-1;
-                        strncpy(filename, p, len);
-                        filename[len] = '\0';
-
-                        int xcol, ycol;
-                        uint32_t color = DEFAULT_CSV_COLOR;
-                        unsigned int hex_in;
-                        int args = sscanf(end + 1, " %d %d %x", &xcol, &ycol, &hex_in);
-
-                        if (args >= 2) {
-                            if (args == 3) color = hex_in;
-
-                            add_plot_csv(filename, xcol, ycol, color);
-
-                            double d1, d2, d3, d4;
-                            if (!view.locked) {
-                                if (plot_from_csv(surf, filename, xcol, ycol, color, &d1, &d2, &d3, &d4)) {
-                                    view.xmin = d1; view.xmax = d2;
-                                    view.ymin = d3; view.ymax = d4;
-                                }
-                            }
-
-                            replot_all(surf);
-
-                            printf("\n");
-                            render_full_w_axes(surf, view.xmin, view.xmax, view.ymin, view.ymax, global_x_ticks, global_y_ticks, true);
-                            printf("\n");
-                        } else printf("Usage: plot \"file.csv\" <x_col> <y_col> [hex_color]\n");
-                    } else printf("Error: Missing closing quote.\n");
-                }
-                else {
-                    char expr_buf[MAX_LINE];
-                    uint32_t color = DEFAULT_COLOR;
-                    strncpy(expr_buf, line, MAX_LINE);
-
-                    char *expr_start = expr_buf + 5;
-                    while(*expr_start == ' ') expr_start++;
-
-                    char *last_space = strrchr(expr_start, ' ');
-                    if (last_space) {
-                        if (strncmp(last_space + 1, "0x", 2) == 0 || strncmp(last_space + 1, "0X", 2) == 0) {
-                            if (parse_hex(last_space + 1, &color)) {
-                                *last_space = '\0';
-                            }
-                        }
-                    }
+                stats_enabled = false;
+                say("Stats off.\n");
+            }
+        } else if (*arg == '\0') {
+            if (!stats_enabled) say("Stats are off, enable with 'stats on'.\n");
+            else stats_print(output.script ? stderr : stdout, &stats_last);
+        } else complain("Usage: stats [on|off]\n");
+    }
 
-                    add_plot_expr(expr_start, color);
+    else if (strncmp(line, "plot", 4) == 0) {
+        const char *p = line + 4;
+        while (*p == ' ' || *p == '\t') p++;
 
-                    replot_all(surf);
+        // "plot" -> view current state
+        if (*p == '\0' || *p == '\n') {
+            show_frame();
+            say("\n");
+        }
+        // "plot ..." -> new plot, parsed in a copy as long as the line
+        else {
+            char local[MAX_LINE];
+            size_t line_len = strlen(line);
+            char *scratch = line_len < sizeof(local) ? local : MALLOC(char, line_len + 1);
+            // curves are tried first, lines that aren't one fall back to an expression
+            bool curve = (strncmp(p, "param", 5) == 0 || strncmp(p, "polar", 5) == 0) && (p[5] == ' ' || p[5] == '\0');
+            bool polar = p[1] == 'o';
+            if (*p == '"' || *p == '\'') {
+                char quote = *p++;
+                const char *end = strchr(p, quote);
+                if (end) {
+                    char *filename = scratch;
+                    size_t len = (size_t)(end - p);
+                    memcpy(filename, p, len);
+                    filename[len] = '\0';
+
+                    int xcol, ycol;
+                    uint32_t color = DEFAULT_CSV_COLOR;
+                    unsigned int hex_in;
+                    int args = sscanf(end + 1, " %d %d %x", &xcol, &ycol, &hex_in);
+
+                    if (args >= 2) {
+                        if (args == 3) color = hex_in;
+
+                        PlotCmd *cmd = plots_add_csv(plots, filename, xcol, ycol, csv_flags, color);
+                        if (cmd) {
+                            follow_series(pane, &cmd->series);
+                            pane->dirty = true;
+                            show_frame();
+                            say("\n");
+                        } else complain("Error: Nothing to plot in %s.\n", filename);
+                    } else complain("Usage: plot \"file.csv\" <x_col> <y_col> [hex_color]\n");
+                } else complain("Error: Missing closing quote.\n");
+            }
+            else if (!curve || !exec_plot_curve(strcpy(scratch, p + 5), polar)) {
+                uint32_t color = DEFAULT_COLOR;
+                strcpy(scratch, line);
+
+                char *expr_start = scratch + 5;
+                while(*expr_start == ' ') expr_start++;
+
+                char *last_space = strrchr(expr_start, ' ');
+                if (last_space) {
+                    if (strncmp(last_space + 1, "0x", 2) == 0 || strncmp(last_space + 1, "0X", 2) == 0) {
+                        if (parse_hex(last_space + 1, &color)) {
+                            *last_space = '\0';
+                        }
+                    }
+                }
 
-                    printf("\n");
-                    render_full_w_axes(surf, view.xmin, view.xmax, view.ymin, view.ymax, global_x_ticks, global_y_ticks, true);
-                    printf("\n");
+                if (plots_add_expr(plots, &params, expr_start, color)) {
+                    pane->dirty = true;
+                    show_frame();
+                    say("\n");
                 }
+                else if (curve && polar) complain("Usage: plot polar <r(t)> [t0 t1] [hex_color]   (t defaults to 0..2pi)\n");
+                else if (curve) complain("Usage: plot param <x(t)> <y(t)> <t0> <t1> [hex_color]\n");
+                else complain("Error: Can't parse '%s'.\n", expr_start);
             }
+            if (scratch != local) free(scratch);
         }
-        else printf("Error: Unknown command.\n");
+    }
+    else complain("Error: Unknown command.\n");
+
+
+    return true;
+}
+
+void repl(Canvas *surf) {
+    char line[MAX_LINE];
+    panes[0].surf = surf;
+    char *cmd_history[MAX_CMD_HISTORY] = {0};
+    int cmd_hist_len = 0, cmd_hist_idx = 0;
+
+    enable_raw_mode();
+
+    printf(" > ");
+    fflush(stdout);
+
+    while (readline(line, sizeof(line), cmd_history, &cmd_hist_len, &cmd_hist_idx) > 0) {
+        if (!exec_command(line)) break;
+        if (watching) watch_sync(); // plots may have come or gone
 
         printf(" > ");
         fflush(stdout);
     }
 
     for(int i=0; i<cmd_hist_len; i++) free(cmd_history[i]);
+    watch_close(&watcher);
+    watching = false;
+    frame_buf_close();
     disable_raw_mode();
 }
+
+int repl_run_script(Canvas *surf, const char *path, const char *out_dir, const char *stem, bool use_color) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+
+    output.script = path;
+    output.line_no = 0;
+    output.out_dir = out_dir;
+    output.stem = stem;
+    output.frame_no = 0;
+    output.use_color = use_color;
+    output.errors = 0;
+    panes[0].surf = surf;
+
+    // lines of any length, commands size their buffers to the line
+    char *line = NULL;
+    size_t line_cap = 0;
+    while (getline(&line, &line_cap, f) != -1) {
+        output.line_no++;
+        line[strcspn(line, "\r\n")] = '\0';
+
+        char *p = line;
+        while (*p == ' ' || *p == '\t') p++;
+        if (*p == '\0' || *p == '#') continue; // blank or comment
+
+        if (!exec_command(p)) break;
+    }
+    if (!out_dir) fflush(stdout);
+    frame_buf_close();
+
+    free(line);
+    fclose(f);
+    output.script = NULL;
+    output.out_dir = NULL;
+    return output.errors ? -1 : output.frame_no;
+}
@@ -0,0 +1,160 @@
+#define _POSIX_C_SOURCE 200809L
+#include <time.h>
+#include <pthread.h>
+#include "../include/common.h"
+#include "../include/stats.h"
+
+static const char *stage_names[STAGE_COUNT] = {
+    "replot_all", "plot_expr", "plot_csv", "overlay", "csv_load", "render_full_w_axes"
+};
+
+static const char *counter_names[COUNTER_COUNT] = {
+    "evaluations", "pixels_set", "bytes_written", "allocations"
+};
+
+bool stats_enabled = false;
+_Thread_local FrameStats stats_current;
+_Thread_local int stats_tid = 1;
+FrameStats stats_last;
+
+// trace events, complete ("X") events for stages and ("C") counter snapshots per frame
+typedef struct {
+    int stage;          // -1 for counter snapshot
+    int tid;
+    double ts, dur;     // seconds since trace start
+    uint64_t counters[COUNTER_COUNT];
+} TraceEvent;
+
+static uint64_t alloc_mark = 0; // atedot_alloc_count at the last frame end
+
+static char *trace_path = NULL;
+static double trace_t0;
+static TraceEvent *trace_events = NULL;
+static size_t trace_len = 0, trace_cap = 0;
+static pthread_mutex_t trace_lock = PTHREAD_MUTEX_INITIALIZER; // pane workers push too
+
+static void trace_push(TraceEvent ev) {
+    pthread_mutex_lock(&trace_lock);
+    if (trace_len == trace_cap) {
+        size_t cap = trace_cap ? trace_cap * 2 : 1024;
+        TraceEvent *grown = REALLOC(TraceEvent, trace_events, cap);
+        if (!grown) { // drop the event rather than die mid-frame
+            pthread_mutex_unlock(&trace_lock);
+            return;
+        }
+        trace_events = grown;
+        trace_cap = cap;
+    }
+    trace_events[trace_len++] = ev;
+    pthread_mutex_unlock(&trace_lock);
+}
+
+double stats_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+void stats_stage_end(StatsStage stage, double t0) {
+    double t1 = stats_now();
+    stats_current.stage_sec[stage] += t1 - t0;
+    stats_current.stage_calls[stage]++;
+
+    if (trace_path) {
+        TraceEvent ev = { (int)stage, stats_tid, t0 - trace_t0, t1 - t0, {0} };
+        trace_push(ev);
+    }
+}
+
+void stats_merge(const FrameStats *fs) {
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        stats_current.stage_sec[i] += fs->stage_sec[i];
+        stats_current.stage_calls[i] += fs->stage_calls[i];
+    }
+    for (int i = 0; i < COUNTER_COUNT; i++) stats_current.counters[i] += fs->counters[i];
+}
+
+void stats_frame_end(void) {
+    if (!stats_enabled) {
+        alloc_mark = atedot_alloc_count;
+        return;
+    }
+    stats_current.counters[COUNTER_ALLOCS] += atedot_alloc_count - alloc_mark; // merged workers already counted theirs
+    alloc_mark = atedot_alloc_count;
+
+    if (trace_path) {
+        TraceEvent ev = { -1, stats_tid, stats_now() - trace_t0, 0, {0} };
+        memcpy(ev.counters, stats_current.counters, sizeof(ev.counters));
+        trace_push(ev);
+    }
+
+    stats_last = stats_current;
+    memset(&stats_current, 0, sizeof(stats_current));
+}
+
+void stats_print(FILE *out, const FrameStats *fs) {
+    double total = fs->stage_sec[STAGE_REPLOT] + fs->stage_sec[STAGE_CSV_LOAD] + fs->stage_sec[STAGE_RENDER];
+    fprintf(out, "last frame: %.3f ms\n", total * 1e3);
+
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        // plots and overlays run inside replot_all, indent them under it
+        const char *indent = (i == STAGE_PLOT_EXPR || i == STAGE_PLOT_CSV || i == STAGE_OVERLAY) ? "    " : "  ";
+        fprintf(out, "%s%-*s %9.3f ms  (%ld call%s)\n", indent, 24 - (int)strlen(indent),
+                stage_names[i], fs->stage_sec[i] * 1e3, fs->stage_calls[i], fs->stage_calls[i] == 1 ? "" : "s");
+    }
+    for (int i = 0; i < COUNTER_COUNT; i++) {
+        fprintf(out, "  %-22s %12llu\n", counter_names[i], (unsigned long long)fs->counters[i]);
+    }
+}
+
+bool stats_trace_start(const char *path) {
+    free(trace_path);
+    trace_path = MALLOC(char, strlen(path) + 1);
+    strcpy(trace_path, path);
+
+    trace_len = 0;
+    trace_t0 = stats_now();
+    stats_enabled = true;
+    return true;
+}
+
+const char *stats_trace_path(void) {
+    return trace_path;
+}
+
+int stats_trace_finish(void) {
+    if (!trace_path) return -1;
+
+    FILE *f = fopen(trace_path, "w");
+    if (!f) {
+        perror(trace_path);
+        return -1;
+    }
+
+    // ts/dur are microseconds in the trace-event format
+    fputs("{\"traceEvents\":[\n", f);
+    for (size_t i = 0; i < trace_len; i++) {
+        const TraceEvent *ev = &trace_events[i];
+        if (ev->stage >= 0) {
+            fprintf(f, "{\"name\":\"%s\",\"cat\":\"atedot\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d}",
+                    stage_names[ev->stage], ev->ts * 1e6, ev->dur * 1e6, ev->tid);
+        } else {
+            fprintf(f, "{\"name\":\"frame\",\"cat\":\"atedot\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"tid\":%d,\"args\":{",
+                    ev->ts * 1e6, ev->tid);
+            for (int c = 0; c < COUNTER_COUNT; c++) {
+                fprintf(f, "%s\"%s\":%llu", c ? "," : "", counter_names[c], (unsigned long long)ev->counters[c]);
+            }
+            fputs("}}", f);
+        }
+        fputs(i + 1 < trace_len ? ",\n" : "\n", f);
+    }
+    fputs("],\"displayTimeUnit\":\"ms\"}\n", f);
+    fclose(f);
+
+    free(trace_events);
+    trace_events = NULL;
+    trace_len = trace_cap = 0;
+    free(trace_path);
+    trace_path = NULL;
+    return 0;
+}
@@ -0,0 +1,151 @@
+#include "../include/common.h"
+#include "../include/timefmt.h"
+
+#define SEC_MIN  60.0
+#define SEC_HOUR 3600.0
+#define SEC_DAY  86400.0
+
+// days since 1970-01-01 for a proleptic gregorian date (H. Hinnant's algorithm)
+int64_t days_from_civil(int y, int m, int d) {
+    y -= m <= 2;
+    int64_t era = (y >= 0 ? y : y - 399) / 400;
+    int64_t yoe = y - era * 400;                                    // [0, 399]
+    int64_t doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;   // [0, 365]
+    int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;            // [0, 146096]
+    return era * 146097 + doe - 719468;
+}
+
+void civil_from_days(int64_t z, int *y, int *m, int *d) {
+    z += 719468;
+    int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    int64_t doe = z - era * 146097;
+    int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    int64_t mp = (5 * doy + 2) / 153;
+    *d = (int)(doy - (153 * mp + 2) / 5 + 1);
+    *m = (int)(mp < 10 ? mp + 3 : mp - 9);
+    *y = (int)(yoe + era * 400 + (*m <= 2));
+}
+
+// fixed position digits, any non-digit poisons the result
+static inline int digits2(const char *p, bool *ok) {
+    unsigned a = (unsigned)(p[0] - '0'), b = (unsigned)(p[1] - '0');
+    if (a > 9 || b > 9) *ok = false;
+    return (int)(a * 10 + b);
+}
+
+bool parse_iso8601(const char *p, size_t len, double *out) {
+    // strip trailing spaces and CR
+    while (len > 0 && (p[len - 1] == ' ' || p[len - 1] == '\r' || p[len - 1] == '\t')) len--;
+    if (len < 19) return false;
+    if (p[4] != '-' || p[7] != '-' || (p[10] != 'T' && p[10] != ' ') || p[13] != ':' || p[16] != ':') return false;
+
+    bool ok = true;
+    int year = digits2(p, &ok) * 100 + digits2(p + 2, &ok);
+    int mon = digits2(p + 5, &ok);
+    int day = digits2(p + 8, &ok);
+    int hour = digits2(p + 11, &ok);
+    int min = digits2(p + 14, &ok);
+    int sec = digits2(p + 17, &ok);
+    if (!ok || mon < 1 || mon > 12 || day < 1 || day > 31 || hour > 23 || min > 59 || sec > 60) return false;
+
+    double t = (double)days_from_civil(year, mon, day) * SEC_DAY + hour * SEC_HOUR + min * SEC_MIN + sec;
+
+    size_t i = 19;
+    if (i < len && p[i] == '.') {
+        double scale = 0.1, frac = 0;
+        size_t start = ++i;
+        for (; i < len && (unsigned)(p[i] - '0') <= 9; i++) {
+            frac += (p[i] - '0') * scale;
+            scale *= 0.1;
+        }
+        if (i == start) return false;
+        t += frac;
+    }
+
+    if (i < len && p[i] == 'Z') i++;
+    else if (i + 6 == len && (p[i] == '+' || p[i] == '-') && p[i + 3] == ':') {
+        int oh = digits2(p + i + 1, &ok), om = digits2(p + i + 4, &ok);
+        if (!ok) return false;
+        double off = oh * SEC_HOUR + om * SEC_MIN;
+        t += p[i] == '+' ? -off : off; // local = utc + offset
+        i += 6;
+    }
+
+    if (i != len) return false;
+    *out = t;
+    return true;
+}
+
+// fixed-length steps in seconds, months and years are handled on the calendar
+static const double time_steps[] = {
+    0.001, 0.002, 0.005, 0.01, 0.02, 0.05, 0.1, 0.2, 0.5,
+    1, 2, 5, 10, 15, 30,
+    SEC_MIN, 2 * SEC_MIN, 5 * SEC_MIN, 10 * SEC_MIN, 15 * SEC_MIN, 30 * SEC_MIN,
+    SEC_HOUR, 2 * SEC_HOUR, 3 * SEC_HOUR, 6 * SEC_HOUR, 12 * SEC_HOUR,
+    SEC_DAY, 2 * SEC_DAY, 7 * SEC_DAY, 14 * SEC_DAY
+};
+
+static const int month_steps[] = { 1, 2, 3, 6, 12, 24, 60, 120, 240, 600, 1200 };
+
+int time_ticks(double tmin, double tmax, int max_ticks, double *out, int out_cap, double *step) {
+    if (!(tmax > tmin) || max_ticks < 2 || out_cap < 1) return 0;
+    double want = (tmax - tmin) / (max_ticks - 1);
+    int n = 0;
+
+    size_t n_steps = sizeof(time_steps) / sizeof(time_steps[0]);
+    if (want <= time_steps[n_steps - 1]) {
+        double s = time_steps[n_steps - 1];
+        for (size_t i = 0; i < n_steps; i++) {
+            if (time_steps[i] >= want) { s = time_steps[i]; break; }
+        }
+        *step = s;
+
+        // weeks start on monday, epoch day 0 was a thursday
+        double origin = s == 7 * SEC_DAY || s == 14 * SEC_DAY ? -3 * SEC_DAY : 0;
+        double t = ceil((tmin - origin) / s) * s + origin;
+        for (; t <= tmax && n < out_cap; t += s) out[n++] = t;
+        return n;
+    }
+
+    // calendar months
+    int months = month_steps[sizeof(month_steps) / sizeof(month_steps[0]) - 1];
+    for (size_t i = 0; i < sizeof(month_steps) / sizeof(month_steps[0]); i++) {
+        if (month_steps[i] * 30.44 * SEC_DAY >= want) { months = month_steps[i]; break; }
+    }
+    *step = months * 30.44 * SEC_DAY;
+
+    int y, m, d;
+    civil_from_days((int64_t)floor(tmin / SEC_DAY), &y, &m, &d);
+    int64_t idx = (int64_t)y * 12 + (m - 1);
+    idx = (idx + months - 1) / months * months; // first boundary at or after tmin's month
+    for (;; idx += months) {
+        int ty = (int)(idx / 12), tm = (int)(idx % 12) + 1;
+        double t = (double)days_from_civil(ty, tm, 1) * SEC_DAY;
+        if (t < tmin) continue;
+        if (t > tmax || n >= out_cap) break;
+        out[n++] = t;
+    }
+    return n;
+}
+
+int format_time_label(char *buf, size_t size, double t, double step) {
+    double days = floor(t / SEC_DAY);
+    double rem = t - days * SEC_DAY;
+    int y, m, d;
+    civil_from_days((int64_t)days, &y, &m, &d);
+
+    int hh = (int)(rem / SEC_HOUR);
+    int mm = (int)(fmod(rem, SEC_HOUR) / SEC_MIN);
+    double ss = fmod(rem, SEC_MIN);
+
+    if (step >= 360 * SEC_DAY) return snprintf(buf, size, "%04d", y);
+    if (step >= 28 * SEC_DAY) return snprintf(buf, size, "%04d-%02d", y, m);
+    if (step >= SEC_DAY) return snprintf(buf, size, "%02d-%02d", m, d);
+    if (step >= SEC_MIN) {
+        if (hh == 0 && mm == 0) return snprintf(buf, size, "%02d-%02d", m, d); // mark midnight
+        return snprintf(buf, size, "%02d:%02d", hh, mm);
+    }
+    if (step >= 1) return snprintf(buf, size, "%02d:%02d:%02d", hh, mm, (int)(ss + 0.5) % 60);
+    return snprintf(buf, size, "%02d:%06.3f", mm, ss);
+}
@@ -1,79 +1,310 @@
+#define _POSIX_C_SOURCE 200809L
+#include <sys/stat.h>
 #include "../../include/common.h"
 #include "../../include/atedot.h"
+#include "../../include/stats.h"
+#include "../../include/timefmt.h"
+#include "../../include/mapping.h"
 
-int plot_from_csv(Canvas *surf, const char *filename, int col_x, int col_y, uint32_t color,
-                    double *out_xmin, double *out_xmax, double *out_ymin, double *out_ymax) {
-    FILE *f = fopen(filename, "r");
+#define CSV_CHUNK (1 << 20)
+#define CSV_MIN_CHUNK 4096      // smallest buffer for appended bytes
+
+static bool series_push(Series *s, double x, double y) {
+    if (s->len == s->cap) {
+        size_t cap = s->cap ? s->cap * 2 : 1024;
+        double *nx = REALLOC(double, s->x, cap);
+        if (!nx) return false;
+        s->x = nx;
+        double *ny = REALLOC(double, s->y, cap);
+        if (!ny) return false;
+        s->y = ny;
+        s->cap = cap;
+    }
+
+    if (x < s->xmin) s->xmin = x;
+    if (x > s->xmax) s->xmax = x;
+    if (y < s->ymin) s->ymin = y;
+    if (y > s->ymax) s->ymax = y;
+
+    s->x[s->len] = x;
+    s->y[s->len] = y;
+    s->len++;
+    return true;
+}
+
+// decimal digit test without locale lookups
+#define IS_DIGIT(c) ((unsigned)((c) - '0') <= 9)
+
+// exact powers of ten, products with a mantissa below 2^53 round correctly
+static const double pow10_table[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+    1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// strtod on a bounded field, for everything the fast path declines
+static bool parse_number_slow(const char *p, const char *end, double *out) {
+    char buf[64];
+    size_t len = (size_t)(end - p);
+    if (len == 0 || len >= sizeof(buf)) return false;
+    memcpy(buf, p, len);
+    buf[len] = '\0';
+
+    char *stop;
+    double v = strtod(buf, &stop);
+    while (*stop == ' ' || *stop == '\r' || *stop == '\t') stop++;
+    if (stop == buf || *stop != '\0') return false;
+    *out = v;
+    return true;
+}
+
+// whole field must be a number, fast path for plain decimals (Clinger)
+static bool parse_number(const char *p, const char *end, double *out) {
+    const char *start = p;
+    while (p < end && (*p == ' ' || *p == '\t')) p++;
+
+    bool neg = false;
+    if (p < end && (*p == '-' || *p == '+')) neg = *p++ == '-';
+
+    uint64_t mant = 0;
+    int digits = 0, exp10 = 0;
+    bool any = false, truncated = false;
+    for (; p < end && IS_DIGIT(*p); p++) {
+        any = true;
+        if (digits < 19) { mant = mant * 10 + (uint64_t)(*p - '0'); if (mant) digits++; }
+        else { exp10++; truncated |= *p != '0'; }
+    }
+    if (p < end && *p == '.') {
+        for (p++; p < end && IS_DIGIT(*p); p++) {
+            any = true;
+            if (digits < 19) { mant = mant * 10 + (uint64_t)(*p - '0'); if (mant) digits++; exp10--; }
+            else truncated |= *p != '0';
+        }
+    }
+    if (!any || truncated) return parse_number_slow(start, end, out); // inf, nan, junk, long mantissas
+    if (p < end && (*p == 'e' || *p == 'E')) return parse_number_slow(start, end, out);
+
+    while (p < end && (*p == ' ' || *p == '\r' || *p == '\t')) p++;
+    if (p != end) return false;
+
+    if (mant >= (1ull << 53) || exp10 < -22 || exp10 > 22) return parse_number_slow(start, end, out);
+
+    double v = (double)mant;
+    v = exp10 < 0 ? v / pow10_table[-exp10] : v * pow10_table[exp10];
+    *out = neg ? -v : v;
+    return true;
+}
+
+// x field: ISO-8601 timestamps are recognised by their fixed layout
+static bool parse_x(Series *s, const char *p, const char *end, int flags, double *out) {
+    if (end - p >= 19 && p[4] == '-' && parse_iso8601(p, (size_t)(end - p), out)) {
+        s->x_time = true;
+        return true;
+    }
+    if (!parse_number(p, end, out)) return false;
+    if (flags & SERIES_X_EPOCH_MS) {
+        *out /= 1000.0;
+        s->x_time = true;
+    }
+    return true;
+}
+
+// one line without its newline, rows with missing or non-numeric fields are skipped
+static bool parse_row(Series *s, const char *p, const char *end, int col_x, int col_y, int flags) {
+    const char *fx = NULL, *fx_end = NULL, *fy = NULL, *fy_end = NULL;
+    int last = col_x > col_y ? col_x : col_y;
+
+    for (int idx = 0; idx <= last; idx++) {
+        const char *f = p;
+        const char *comma = memchr(p, ',', (size_t)(end - p));
+        const char *f_end = comma ? comma : end;
+
+        if (idx == col_x) { fx = f; fx_end = f_end; }
+        if (idx == col_y) { fy = f; fy_end = f_end; }
+
+        if (!comma) {
+            if (idx < last) return true; // too few columns
+            break;
+        }
+        p = comma + 1;
+    }
+
+    double x, y;
+    if (!parse_x(s, fx, fx_end, flags, &x) || !parse_number(fy, fy_end, &y)) return true;
+    return series_push(s, x, y);
+}
+
+size_t series_parse_csv(Series *s, const char *buf, size_t len, bool final,
+                        int col_x, int col_y, int flags) {
+    const char *p = buf, *end = buf + len;
+    while (p < end) {
+        const char *nl = memchr(p, '\n', (size_t)(end - p));
+        if (!nl && !final) break; // partial line, wait for more bytes
+
+        const char *line_end = nl ? nl : end;
+        if (!parse_row(s, p, line_end, col_x, col_y, flags)) {
+            fprintf(stderr, "Error: Out of memory loading csv\n");
+            return len;
+        }
+        p = nl ? nl + 1 : end;
+    }
+    return (size_t)(p - buf);
+}
+
+void series_reset(Series *s) {
+    s->len = 0;
+    s->x_time = false;
+    s->xmin = 1e308; s->xmax = -1e308;
+    s->ymin = 1e308; s->ymax = -1e308;
+}
+
+// rows from the current position to EOF through a buffer of `cap` bytes
+// returns bytes up to the last newline, an unterminated last line is parsed
+// as well, the cursor (if any) records its rows and the extent before them
+static uint64_t read_rows(Series *s, FILE *f, size_t cap, int col_x, int col_y, int flags, CsvCursor *cur) {
+    size_t carry = 0;
+    uint64_t consumed = 0;
+    char *buf = MALLOC(char, cap);
+    if (cur) cur->tail_rows = 0;
+
+    for (;;) {
+        size_t n = fread(buf + carry, 1, cap - carry, f);
+        if (n == 0) {
+            size_t rows = s->len;
+            if (cur) {
+                cur->xmin = s->xmin; cur->xmax = s->xmax;
+                cur->ymin = s->ymin; cur->ymax = s->ymax;
+            }
+            series_parse_csv(s, buf, carry, true, col_x, col_y, flags);
+            if (cur) cur->tail_rows = s->len - rows;
+            break;
+        }
+
+        size_t len = carry + n;
+        size_t used = series_parse_csv(s, buf, len, false, col_x, col_y, flags);
+        consumed += used;
+        carry = len - used;
+
+        if (carry == cap) {
+            // one line longer than the buffer
+            char *grown = REALLOC(char, buf, cap * 2);
+            if (!grown) break;
+            buf = grown;
+            cap *= 2;
+        } else if (carry) memmove(buf, buf + used, carry);
+    }
+
+    free(buf);
+    return consumed;
+}
+
+// whole file in large chunks, samples and min/max are kept in memory
+int series_load_csv(Series *s, const char *filename, int col_x, int col_y, int flags) {
+    STATS_BEGIN(t0);
+    FILE *f = fopen(filename, "rb");
     if (!f) {
         perror("fopen");
+        STATS_END(STAGE_CSV_LOAD, t0);
         return -1;
     }
 
-    char line[512];
-    double x_min = 1e308, x_max = -1e308;
-    double y_min = 1e308, y_max = -1e308;
-
-    // find minmax for scaling
-    int n_points = 0;
-    while (fgets(line, sizeof(line), f)) {
-        char *token;
-        int idx = 0;
-        double x = 0, y = 0;
-        token = strtok(line, ",");
-        while (token) {
-            if (idx == col_x) x = atof(token);
-            if (idx == col_y) y = atof(token);
-            token = strtok(NULL, ",");
-            idx++;
-        }
-        if (idx <= col_x || idx <= col_y) continue; // skip invalid line
+    series_reset(s);
+    read_rows(s, f, CSV_CHUNK, col_x, col_y, flags, NULL);
 
-        if (x < x_min) x_min = x;
-        if (x > x_max) x_max = x;
-        if (y < y_min) y_min = y;
-        if (y > y_max) y_max = y;
+    fclose(f);
+    STATS_END(STAGE_CSV_LOAD, t0);
+    return s->len > 0 ? 0 : -1;
+}
 
-        n_points++;
+// the same file (device and inode) no smaller than what was read continues
+// from the cursor, anything else was truncated or rotated and is read again
+int series_update_csv(Series *s, CsvCursor *cur, const char *filename, int col_x, int col_y, int flags) {
+    STATS_BEGIN(t0);
+    FILE *f = fopen(filename, "rb");
+    struct stat st;
+    if (!f || fstat(fileno(f), &st) != 0) {
+        if (f) fclose(f);
+        STATS_END(STAGE_CSV_LOAD, t0);
+        return CSV_ERROR;
     }
 
-    if (n_points == 0) {
+    uint64_t size = (uint64_t)st.st_size;
+    bool same = cur->ino != 0 && cur->ino == (uint64_t)st.st_ino && cur->dev == (uint64_t)st.st_dev
+                && size >= cur->offset;
+    if (same && size == cur->offset) {
         fclose(f);
-        return -1;
+        STATS_END(STAGE_CSV_LOAD, t0);
+        return CSV_UNCHANGED;
     }
 
-    // Determine axis positions in pixel coordinates
-    int y0 = -1; // x axis
-    if (y_min <= 0 && y_max >= 0) {
-        y0 = (int)((y_max - 0) / (y_max - y_min) * (surf->px_h - 1));
+    if (same && fseeko(f, (off_t)cur->offset, SEEK_SET) == 0) {
+        // the unterminated line is parsed again with whatever was appended to it
+        s->len -= cur->tail_rows;
+        s->xmin = cur->xmin; s->xmax = cur->xmax;
+        s->ymin = cur->ymin; s->ymax = cur->ymax;
+    } else {
+        same = false;
+        rewind(f);
+        series_reset(s);
+        cur->offset = 0;
     }
 
-    int x0 = -1; // y axis
-    if (x_min <= 0 && x_max >= 0) {
-        x0 = (int)((0 - x_min) / (x_max - x_min) * (surf->px_w - 1));
+    // buffer sized to the new bytes, so small appends stay cheap
+    uint64_t pending = size - cur->offset;
+    size_t cap = pending < CSV_MIN_CHUNK ? CSV_MIN_CHUNK : pending < CSV_CHUNK ? (size_t)pending + 1 : CSV_CHUNK;
+    cur->offset += read_rows(s, f, cap, col_x, col_y, flags, cur);
+    cur->dev = (uint64_t)st.st_dev;
+    cur->ino = (uint64_t)st.st_ino;
+
+    fclose(f);
+    STATS_END(STAGE_CSV_LOAD, t0);
+    return same ? CSV_APPENDED : CSV_RELOADED;
+}
+
+void series_free(Series *s) {
+    free(s->x); s->x = NULL;
+    free(s->y); s->y = NULL;
+    s->len = s->cap = 0;
+}
+
+static void draw_samples(Canvas *surf, const Series *s, size_t from, uint32_t color, const Mapping *m) {
+    for (size_t i = from; i < s->len; i++) {
+        double fx = (s->x[i] - m->xmin) * m->sx;
+        double fy = (m->ymax - s->y[i]) * m->sy; // flip y
+        if (fx < 0 || fy < 0 || fx > surf->px_w || fy > surf->px_h) continue;
+
+        canvas_pixel_set(surf, (int)fx, (int)fy, color);
     }
+}
 
-    rewind(f);
+int plot_series_from(Canvas *surf, const Series *s, size_t from, uint32_t color,
+                     double xmin, double xmax, double ymin, double ymax) {
+    STATS_BEGIN(t0);
+    Mapping m = mapping_make(surf, xmin, xmax, ymin, ymax);
+    draw_samples(surf, s, from, color, &m);
+    STATS_END(STAGE_PLOT_CSV, t0);
+    return 0;
+}
 
-    // plot points
-    while (fgets(line, sizeof(line), f)) {
-        char *token;
-        int idx = 0;
-        double x = 0, y = 0;
-        token = strtok(line, ",");
-        while (token) {
-            if (idx == col_x) x = atof(token);
-            if (idx == col_y) y = atof(token);
-            token = strtok(NULL, ",");
-            idx++;
-        }
-        if (idx <= col_x || idx <= col_y) continue;
+// draw samples mapped into the given world window, no allocation
+int plot_series(Canvas *surf, const Series *s, uint32_t color,
+                double xmin, double xmax, double ymin, double ymax) {
+    STATS_BEGIN(t0);
+    Mapping m = mapping_make(surf, xmin, xmax, ymin, ymax);
 
-        int px = (int)((x - x_min) / (x_max - x_min) * (surf->px_w - 1));
-        int py = (int)((y_max - y) / (y_max - y_min) * (surf->px_h - 1)); // flip y
+    // Determine axis positions in pixel coordinates
+    int y0 = -1; // x axis
+    if (ymin <= 0 && ymax >= 0) {
+        y0 = (int)((ymax - 0) / m.yrange * (surf->px_h - 1));
+    }
 
-        canvas_pixel_set(surf, px, py, color);
+    int x0 = -1; // y axis
+    if (xmin <= 0 && xmax >= 0) {
+        x0 = (int)((0 - xmin) / m.xrange * (surf->px_w - 1));
     }
 
+    // plot points
+    draw_samples(surf, s, 0, color, &m);
+
     // draw axes
     if (y0 >= 0) plot_line(surf, 0, y0, surf->px_w - 1, y0, 0x000000);
     if (x0 >= 0) plot_line(surf, x0, 0, x0, surf->px_h - 1, 0x000000);
@@ -81,12 +312,22 @@ int plot_from_csv(Canvas *surf, const char *filename, int col_x, int col_y, uint
     // axis ticks
     // plot_ax_ticks_numbers(surf, x_min, x_max, y_min, y_max, x0, y0);
 
-    fclose(f);
+    STATS_END(STAGE_PLOT_CSV, t0);
+    return 0;
+}
 
-    if (out_xmin) *out_xmin = x_min;
-    if (out_xmax) *out_xmax = x_max;
-    if (out_ymin) *out_ymin = y_min;
-    if (out_ymax) *out_ymax = y_max;
+int plot_from_csv(Canvas *surf, const char *filename, int col_x, int col_y, uint32_t color,
+                    double *out_xmin, double *out_xmax, double *out_ymin, double *out_ymax) {
+    Series s = {0};
+    int rc = series_load_csv(&s, filename, col_x, col_y, 0);
+    if (rc == 0) {
+        plot_series(surf, &s, color, s.xmin, s.xmax, s.ymin, s.ymax);
 
-    return 0;
+        if (out_xmin) *out_xmin = s.xmin;
+        if (out_xmax) *out_xmax = s.xmax;
+        if (out_ymin) *out_ymin = s.ymin;
+        if (out_ymax) *out_ymax = s.ymax;
+    }
+    series_free(&s);
+    return rc;
 }
@@ -0,0 +1,124 @@
+#include "../../include/common.h"
+#include "../../include/atedot.h"
+#include "../../include/stats.h"
+#include "../../include/mapping.h"
+
+// parametric and polar curves, sampled in t with a step that follows the
+// on-screen arc length: visible segments longer than CURVE_MAX_PX are refined
+// (CURVE_STRAIGHT_PX while the curve keeps its direction), batches of short
+// segments widen the step, and samples are joined with plot_line
+
+#define CURVE_BATCH 64          // t samples evaluated per call
+#define CURVE_MAX_PX 3.0        // longest visible segment on a bend
+#define CURVE_STRAIGHT_PX 16.0  // longest visible segment on a straight run
+#define CURVE_STRAIGHT_SIN 0.03 // sine of the largest turn that still counts as straight (~1.7 deg)
+#define CURVE_GROW_PX 1.5       // a batch shorter than this per segment doubles the step
+#define CURVE_MAX_EVALS (1 << 20)
+
+typedef struct {
+    const ExprProgram *fx, *fy; // fy is NULL for polar, fx is then r(t)
+    const double *px, *py;      // bound parameters
+} Curve;
+
+static void curve_eval(const Curve *c, const double *t, double *x, double *y, int n) {
+    if (c->fy) {
+        expr_run_batch(c->fx, t, x, n, c->px);
+        expr_run_batch(c->fy, t, y, n, c->py);
+        return;
+    }
+    expr_run_batch(c->fx, t, x, n, c->px);
+    for (int i = 0; i < n; i++) {
+        double r = x[i];
+        x[i] = r * cos(t[i]);
+        y[i] = r * sin(t[i]);
+    }
+}
+
+static long trace_curve(Canvas *surf, const Curve *c, double t0, double t1, uint32_t color, const Mapping *m) {
+    double span = t1 - t0;
+    double dt = span / 1024, dt_min = span * 1e-7, dt_max = span / 256;
+
+    double ts[CURVE_BATCH], xs[CURVE_BATCH], ys[CURVE_BATCH];
+    curve_eval(c, &t0, xs, ys, 1);
+    long evals = 1;
+
+    double t = t0;
+    double prev_x = (xs[0] - m->xmin) * m->sx, prev_y = (m->ymax - ys[0]) * m->sy;
+    bool have_prev = isfinite(prev_x) && isfinite(prev_y);
+    double dir_x = 0, dir_y = 0; // unit direction of the last visible segment, 0 if none
+    int px0, py0;
+    if (map_point(m, xs[0], ys[0], &px0, &py0)) canvas_pixel_set(surf, px0, py0, color);
+
+    while (t < t1 && evals < CURVE_MAX_EVALS) {
+        int n = 0;
+        while (n < CURVE_BATCH) {
+            double tk = t + (n + 1) * dt;
+            ts[n++] = tk < t1 ? tk : t1;
+            if (tk >= t1) break;
+        }
+        curve_eval(c, ts, xs, ys, n);
+        evals += n;
+
+        double longest = 0;
+        int k;
+        for (k = 0; k < n; k++) {
+            double px = (xs[k] - m->xmin) * m->sx;
+            double py = (m->ymax - ys[k]) * m->sy;
+            bool finite = isfinite(px) && isfinite(py);
+
+            if (finite && have_prev) {
+                double ax = prev_x, ay = prev_y, bx = px, by = py;
+                bool visible = clip_segment(m, &ax, &ay, &bx, &by);
+                double len = hypot(px - prev_x, py - prev_y);
+
+                if (visible) {
+                    // too coarse where it shows, refine from the last accepted sample
+                    // (below dt_min it is a jump, e.g. an asymptote, and is drawn as is)
+                    double ux = len > 0 ? (px - prev_x) / len : 0, uy = len > 0 ? (py - prev_y) / len : 0;
+                    bool straight = ux * dir_x + uy * dir_y > 0 && fabs(ux * dir_y - uy * dir_x) < CURVE_STRAIGHT_SIN;
+                    if (len > (straight ? CURVE_STRAIGHT_PX : CURVE_MAX_PX) && dt > dt_min) break;
+
+                    plot_line(surf, (int)ax, (int)ay, (int)bx, (int)by, color);
+                    if (len > longest) longest = len;
+                    if (len > 0.5) { dir_x = ux; dir_y = uy; }
+                } else dir_x = dir_y = 0;
+            } else dir_x = dir_y = 0;
+            prev_x = px; prev_y = py;
+            have_prev = finite;
+            t = ts[k];
+        }
+
+        if (k < n) dt = fmax(dt * 0.25, dt_min);
+        else if (longest < CURVE_GROW_PX) dt = fmin(dt * 2, dt_max);
+    }
+    return evals;
+}
+
+static int plot_curve(Canvas *surf, const Curve *c, double t0, double t1, uint32_t color,
+                      double xmin, double xmax, double ymin, double ymax) {
+    STATS_BEGIN(s0);
+    if (!(t1 > t0) || !isfinite(t1 - t0)) {
+        STATS_END(STAGE_PLOT_EXPR, s0);
+        return -1;
+    }
+
+    Mapping m = mapping_make(surf, xmin, xmax, ymin, ymax);
+    long evals = trace_curve(surf, c, t0, t1, color, &m);
+
+    STATS_COUNT(COUNTER_EVALS, evals);
+    STATS_END(STAGE_PLOT_EXPR, s0);
+    return 0;
+}
+
+int plot_parametric(Canvas *surf, const ExprProgram *fx, const double *fx_params,
+                    const ExprProgram *fy, const double *fy_params, double t0, double t1,
+                    uint32_t color, double xmin, double xmax, double ymin, double ymax) {
+    Curve c = { fx, fy, fx_params, fy_params };
+    return plot_curve(surf, &c, t0, t1, color, xmin, xmax, ymin, ymax);
+}
+
+int plot_polar(Canvas *surf, const ExprProgram *r, const double *params, double t0, double t1,
+               uint32_t color, double xmin, double xmax, double ymin, double ymax) {
+    Curve c = { r, NULL, params, NULL };
+    return plot_curve(surf, &c, t0, t1, color, xmin, xmax, ymin, ymax);
+}
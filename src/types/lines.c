@@ -1,6 +1,8 @@
 #include "../../include/common.h"
 #include "../../include/atedot.h"
 #include "../../include/expr.h"
+#include "../../include/stats.h"
+#include "../../include/mapping.h"
 
 // bresenham line generation in pixel space
 int plot_line(Canvas *surf, int x0, int y0, int x1, int y1, uint32_t color) {
@@ -17,32 +19,40 @@ int plot_line(Canvas *surf, int x0, int y0, int x1, int y1, uint32_t color) {
     return 0;
 }
 
-int plot_expr(Canvas *surf, const char *line, uint32_t color,
-              double xmin, double xmax, double ymin, double ymax) {
+int plot_program(Canvas *surf, const ExprProgram *prog, const double *params, uint32_t color,
+                 double xmin, double xmax, double ymin, double ymax) {
+    STATS_BEGIN(t0);
 
-    double xrange = xmax - xmin;
-    double yrange = ymax - ymin;
-    if (fabs(xrange) < 1e-9) xrange = 1.0;
-    if (fabs(yrange) < 1e-9) yrange = 1.0;
-
-    // skip "plot " if present
-    const char *expr_str = line;
-    if (strncmp(expr_str, "plot ", 5) == 0) expr_str += 5;
+    Mapping m = mapping_make(surf, xmin, xmax, ymin, ymax);
 
-    int err = 0;
-    for (int px = 0; px < surf->px_w; ++px) {
-        double x_world = xmin + (double)px / (surf->px_w - 1) * xrange;
+    int err = 0, px;
+    for (px = 0; px < surf->px_w; ++px) {
+        double x_world = xmin + (double)px / (surf->px_w - 1) * m.xrange;
 
-        double y_world = expr_eval(expr_str, x_world, &err);
+        double y_world = expr_run(prog, x_world, params, &err);
 
-        if (err) return -1;
+        if (err) break;
 
-        int py = (int)((ymax - y_world) / yrange * (surf->px_h - 1));
+        int py = (int)((ymax - y_world) / m.yrange * (surf->px_h - 1));
 
         if (py >= 0 && py < surf->px_h) {
             canvas_pixel_set(surf, px, py, color);
         }
     }
 
-    return 0;
+    STATS_COUNT(COUNTER_EVALS, err ? px + 1 : px);
+    STATS_END(STAGE_PLOT_EXPR, t0);
+    return err ? -1 : 0;
+}
+
+// compiled once per call, not once per pixel
+int plot_expr(Canvas *surf, const char *line, uint32_t color,
+              double xmin, double xmax, double ymin, double ymax) {
+    // skip "plot " if present
+    const char *expr_str = line;
+    if (strncmp(expr_str, "plot ", 5) == 0) expr_str += 5;
+
+    ExprProgram prog;
+    if (expr_compile(&prog, expr_str) != 0 || prog.n_params > 0) return -1;
+    return plot_program(surf, &prog, NULL, color, xmin, xmax, ymin, ymax);
 }
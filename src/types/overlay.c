@@ -0,0 +1,192 @@
+#include "../../include/common.h"
+#include "../../include/atedot.h"
+#include "../../include/stats.h"
+#include "../../include/mapping.h"
+
+// statistical overlays drawn on top of a loaded series
+// each one is a single streaming pass over the samples
+
+// least squares sums over samples [fitted, len), x is shifted by the first sample
+// for precision, four independent lanes so the reduction vectorises
+static void fit_accumulate(Overlay *o, const Series *s) {
+    if (o->fitted == 0 && s->len > 0) o->x_ref = s->x[0];
+
+    const double *x = s->x, *y = s->y;
+    double ref = o->x_ref;
+    double sx[4] = {0}, sy[4] = {0}, sxx[4] = {0}, sxy[4] = {0};
+
+    size_t i = o->fitted;
+    for (; i + 4 <= s->len; i += 4) {
+        for (int k = 0; k < 4; k++) {
+            double dx = x[i + k] - ref;
+            sx[k] += dx;
+            sy[k] += y[i + k];
+            sxx[k] += dx * dx;
+            sxy[k] += dx * y[i + k];
+        }
+    }
+    for (; i < s->len; i++) {
+        double dx = x[i] - ref;
+        sx[0] += dx; sy[0] += y[i];
+        sxx[0] += dx * dx; sxy[0] += dx * y[i];
+    }
+
+    o->sum_x += (sx[0] + sx[1]) + (sx[2] + sx[3]);
+    o->sum_y += (sy[0] + sy[1]) + (sy[2] + sy[3]);
+    o->sum_xx += (sxx[0] + sxx[1]) + (sxx[2] + sxx[3]);
+    o->sum_xy += (sxy[0] + sxy[1]) + (sxy[2] + sxy[3]);
+    o->fitted = s->len;
+}
+
+// polyline that only rasterises when the pixel changes, breaks off-canvas
+typedef struct {
+    int x, y;
+    bool open;
+} Pen;
+
+static void pen_px(Canvas *surf, Pen *pen, int px, int py, uint32_t color) {
+    if (pen->open && px == pen->x && py == pen->y) return;
+
+    if (pen->open) plot_line(surf, pen->x, pen->y, px, py, color);
+    else canvas_pixel_set(surf, px, py, color);
+    pen->x = px; pen->y = py; pen->open = true;
+}
+
+static void pen_to(Canvas *surf, Pen *pen, const Mapping *m, double x, double y, uint32_t color) {
+    int px, py;
+    if (!map_point(m, x, y, &px, &py)) { pen->open = false; return; }
+    pen_px(surf, pen, px, py, color);
+}
+
+static void draw_mean(Canvas *surf, const Series *s, const Overlay *o, uint32_t color, const Mapping *m) {
+    size_t w = (size_t)o->window;
+    if (w == 0 || s->len < w) return;
+
+    // trailing window, O(1) per sample since old samples are still in memory
+    Pen pen = {0};
+    double sum = 0;
+    for (size_t i = 0; i < s->len; i++) {
+        sum += s->y[i];
+        if (i >= w) sum -= s->y[i - w];
+        if (i + 1 >= w) pen_to(surf, &pen, m, s->x[i], sum / (double)w, color);
+    }
+    STATS_COUNT(COUNTER_EVALS, s->len);
+}
+
+static void draw_fit(Canvas *surf, const Series *s, Overlay *o, uint32_t color,
+                     double xmin, double xmax, double ymin, double ymax, const Mapping *m) {
+    if (s->len > o->fitted) fit_accumulate(o, s);
+
+    double n = (double)o->fitted;
+    double den = n * o->sum_xx - o->sum_x * o->sum_x;
+    if (o->fitted < 2 || fabs(den) < 1e-300) return;
+
+    double slope = (n * o->sum_xy - o->sum_x * o->sum_y) / den;
+    double icept = (o->sum_y - slope * o->sum_x) / n;
+    o->slope = slope;
+    o->intercept = icept - slope * o->x_ref; // back in unshifted x
+
+    // clip y = a + b*x to the view before rasterising
+    double x0 = xmin, x1 = xmax;
+    if (fabs(slope) <= 1e-300) {
+        if (o->intercept < fmin(ymin, ymax) || o->intercept > fmax(ymin, ymax)) return; // flat, above or below
+    } else {
+        double xa = (ymin - o->intercept) / slope;
+        double xb = (ymax - o->intercept) / slope;
+        if (xa > xb) { double t = xa; xa = xb; xb = t; }
+        if (xa > x0) x0 = xa;
+        if (xb < x1) x1 = xb;
+        if (x0 > x1) return;
+    }
+
+    // the ends can still land far off the canvas after rounding (degenerate views),
+    // so clip in pixel space too before casting to int
+    double px0 = (x0 - m->xmin) * m->sx, py0 = (m->ymax - (o->intercept + slope * x0)) * m->sy;
+    double px1 = (x1 - m->xmin) * m->sx, py1 = (m->ymax - (o->intercept + slope * x1)) * m->sy;
+    if (!clip_segment(m, &px0, &py0, &px1, &py1)) return;
+    plot_line(surf, (int)px0, (int)py0, (int)px1, (int)py1, color);
+}
+
+// first bin whose cumulative count reaches `rank`
+static int bin_at_rank(const uint32_t *bins, int n_bins, double rank) {
+    double cum = 0;
+    for (int b = 0; b < n_bins; b++) {
+        cum += bins[b];
+        if (cum >= rank) return b;
+    }
+    return n_bins - 1;
+}
+
+static void draw_band(Canvas *surf, const Series *s, Overlay *o, uint32_t color, const Mapping *m) {
+    // quantile sketch per pixel column: a histogram over the pixel rows, so it is
+    // exact at display resolution and costs one increment per sample
+    // bin 0 is below the view, 1..h are rows bottom to top, h+1 is above
+    int n_bins = m->h + 2;
+    size_t need = (size_t)m->w * (size_t)n_bins;
+    if (o->bin_cap < need) {
+        uint32_t *grown = REALLOC(uint32_t, o->bins, need);
+        if (!grown) return;
+        o->bins = grown;
+        o->bin_cap = need;
+    }
+    memset(o->bins, 0, need * sizeof(uint32_t));
+
+    for (size_t i = 0; i < s->len; i++) {
+        double fx = (s->x[i] - m->xmin) * m->sx;
+        if (!(fx >= 0 && fx < m->w)) continue;
+
+        double fy = (m->ymax - s->y[i]) * m->sy;
+        int b;
+        if (fy < 0) b = n_bins - 1;
+        else if (fy >= m->h) b = 0;
+        else b = m->h - (int)fy;
+        o->bins[(size_t)(int)fx * (size_t)n_bins + (size_t)b]++;
+    }
+    STATS_COUNT(COUNTER_EVALS, s->len);
+
+    // lower and upper envelopes, broken where the quantile leaves the view
+    Pen lo = {0}, hi = {0};
+    for (int c = 0; c < m->w; c++) {
+        const uint32_t *bins = &o->bins[(size_t)c * (size_t)n_bins];
+        double total = 0;
+        for (int b = 0; b < n_bins; b++) total += bins[b];
+        if (total == 0) continue;
+
+        int b_lo = bin_at_rank(bins, n_bins, fmax(1.0, o->q_lo / 100.0 * total));
+        int b_hi = bin_at_rank(bins, n_bins, fmax(1.0, o->q_hi / 100.0 * total));
+
+        if (b_lo > 0 && b_lo < n_bins - 1) pen_px(surf, &lo, c, m->h - b_lo, color);
+        else lo.open = false;
+        if (b_hi > 0 && b_hi < n_bins - 1) pen_px(surf, &hi, c, m->h - b_hi, color);
+        else hi.open = false;
+    }
+}
+
+int plot_overlay(Canvas *surf, const Series *s, Overlay *o, uint32_t color,
+                 double xmin, double xmax, double ymin, double ymax) {
+    STATS_BEGIN(t0);
+
+    Mapping m = mapping_make(surf, xmin, xmax, ymin, ymax);
+
+    switch (o->kind) {
+        case OVERLAY_MEAN: draw_mean(surf, s, o, color, &m); break;
+        case OVERLAY_FIT_LINEAR: draw_fit(surf, s, o, color, xmin, xmax, ymin, ymax, &m); break;
+        case OVERLAY_BAND: draw_band(surf, s, o, color, &m); break;
+    }
+
+    STATS_END(STAGE_OVERLAY, t0);
+    return 0;
+}
+
+void overlay_reset(Overlay *o) {
+    o->fitted = 0;
+    o->x_ref = 0;
+    o->sum_x = o->sum_y = o->sum_xx = o->sum_xy = 0;
+    o->slope = o->intercept = 0;
+}
+
+void overlay_free(Overlay *o) {
+    free(o->bins);
+    o->bins = NULL;
+    o->bin_cap = 0;
+}
@@ -0,0 +1,101 @@
+#define _POSIX_C_SOURCE 200809L
+#include "../include/common.h"
+#include "../include/watch.h"
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <errno.h>
+
+#define WATCH_EVENTS (IN_MODIFY | IN_CLOSE_WRITE | IN_CREATE | IN_MOVED_TO | IN_DELETE)
+
+int watch_open(Watcher *w) {
+    w->count = 0;
+    w->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (w->fd < 0) {
+        perror("inotify_init1");
+        return -1;
+    }
+    return 0;
+}
+
+int watch_add(Watcher *w, const char *path) {
+    if (w->fd < 0) return -1;
+
+    char dir[WATCH_MAX_NAME];
+    const char *slash = strrchr(path, '/');
+    const char *base = slash ? slash + 1 : path;
+    size_t dir_len = slash ? (size_t)(slash - path) : 0;
+    if (*base == '\0' || strlen(base) >= WATCH_MAX_NAME || dir_len >= sizeof(dir)) return -1;
+
+    if (!slash) strcpy(dir, ".");
+    else if (dir_len == 0) strcpy(dir, "/");
+    else {
+        memcpy(dir, path, dir_len);
+        dir[dir_len] = '\0';
+    }
+
+    // the kernel hands out one descriptor per directory, however often it is added
+    int wd = inotify_add_watch(w->fd, dir, WATCH_EVENTS);
+    if (wd < 0) {
+        perror(dir);
+        return -1;
+    }
+
+    for (int i = 0; i < w->count; i++) {
+        if (w->dirs[i] == wd && strcmp(w->names[i], base) == 0) return 0;
+    }
+    if (w->count == WATCH_MAX_FILES) return -1;
+    w->dirs[w->count] = wd;
+    strcpy(w->names[w->count], base);
+    w->count++;
+    return 0;
+}
+
+// directory watches stay, events for files no longer listed are ignored
+void watch_reset(Watcher *w) {
+    w->count = 0;
+}
+
+bool watch_drain(Watcher *w) {
+    _Alignas(struct inotify_event) char buf[4096];
+    bool hit = false;
+
+    for (;;) {
+        ssize_t n = read(w->fd, buf, sizeof(buf));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+
+        for (char *p = buf; p < buf + n; ) {
+            const struct inotify_event *ev = (const struct inotify_event*)p;
+            if (ev->mask & IN_Q_OVERFLOW) hit = true; // events were lost, assume the worst
+            for (int i = 0; i < w->count && !hit && ev->len; i++) {
+                hit = w->dirs[i] == ev->wd && strcmp(w->names[i], ev->name) == 0;
+            }
+            p += sizeof(struct inotify_event) + ev->len;
+        }
+    }
+    return hit;
+}
+
+void watch_close(Watcher *w) {
+    if (w->fd >= 0) close(w->fd);
+    w->fd = -1;
+    w->count = 0;
+}
+
+#else
+
+int watch_open(Watcher *w) {
+    w->fd = -1;
+    w->count = 0;
+    fprintf(stderr, "watch: inotify is not available on this platform\n");
+    return -1;
+}
+
+int watch_add(Watcher *w, const char *path) { (void)w; (void)path; return -1; }
+void watch_reset(Watcher *w) { w->count = 0; }
+bool watch_drain(Watcher *w) { (void)w; return false; }
+void watch_close(Watcher *w) { w->fd = -1; w->count = 0; }
+
+#endif